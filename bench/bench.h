@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// 简单的微基准框架。
+/// bench [--filter=子串] [--min-time=毫秒] [--repetitions=N] [--format=text|json] [--out=文件]
+/// 每个用例调整迭代次数使一次测量不少于 min-time，重复 repetitions 次取中位数。
+/// json 格式便于保存下来跟踪不同版本的结果。
+/// </summary>
+namespace bench
+{
+    template<typename T>
+    inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    inline void clobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        double nsPerOp = 0;
+        double minNsPerOp = 0;
+        uint64_t iterations = 0;
+    };
+
+    class Runner {
+    public:
+        Runner(int argc, char** argv) {
+            for (int i = 1; i < argc; ++i) {
+                const char* arg = argv[i];
+                if (const char* v = value(arg, "--filter=")) {
+                    m_filter = v;
+                }
+                else if (const char* v = value(arg, "--min-time=")) {
+                    m_minTime = std::atof(v) * 1e6;
+                }
+                else if (const char* v = value(arg, "--repetitions=")) {
+                    m_repetitions = (std::max)(1, std::atoi(v));
+                }
+                else if (const char* v = value(arg, "--format=")) {
+                    m_json = std::strcmp(v, "json") == 0;
+                }
+                else if (const char* v = value(arg, "--out=")) {
+                    m_out = v;
+                }
+                else {
+                    std::fprintf(stderr, "unknown argument: %s\n", arg);
+                }
+            }
+        }
+
+        bool enabled(const std::string& name) const {
+            return m_filter.empty() || name.find(m_filter) != std::string::npos;
+        }
+
+        /// fn(n) 执行 n 次被测操作。
+        template<typename Func>
+        void run(const std::string& name, Func&& fn) {
+            runTimed(name, [&](uint64_t n) {
+                auto begin = std::chrono::steady_clock::now();
+                fn(n);
+                clobberMemory();
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+            });
+        }
+
+        /// fn(n) 执行 n 次被测操作并返回其中需要计时部分的纳秒数，用于需要在计时外准备数据的用例。
+        template<typename Func>
+        void runTimed(const std::string& name, Func&& fn) {
+            if (!enabled(name)) {
+                return;
+            }
+
+            fn(1);
+            uint64_t n = 1;
+            double elapsed = 0;
+            for (;;) {
+                elapsed = fn(n);
+                if (elapsed >= m_minTime || n >= (uint64_t(1) << 40)) {
+                    break;
+                }
+                double scale = elapsed > 0 ? m_minTime * 1.2 / elapsed : 100.0;
+                n = static_cast<uint64_t>(n * (std::min)((std::max)(scale, 2.0), 100.0));
+            }
+
+            std::vector<double> samples{ elapsed / n };
+            for (int i = 1; i < m_repetitions; ++i) {
+                samples.push_back(fn(n) / n);
+            }
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name = name;
+            result.nsPerOp = samples[samples.size() / 2];
+            result.minNsPerOp = samples.front();
+            result.iterations = n;
+            if (!m_json) {
+                std::printf("%-48s %12.2f ns/op %12.2f min %14llu iterations\n", name.c_str(), result.nsPerOp,
+                    result.minNsPerOp, static_cast<unsigned long long>(n));
+                std::fflush(stdout);
+            }
+            m_results.push_back(result);
+        }
+
+        int finish() const {
+            if (!m_json) {
+                return 0;
+            }
+
+            FILE* out = m_out.empty() ? stdout : std::fopen(m_out.c_str(), "w");
+            if (!out) {
+                std::fprintf(stderr, "cannot open %s\n", m_out.c_str());
+                return 1;
+            }
+
+            std::fprintf(out, "{\n  \"context\": {\n");
+            std::fprintf(out, "    \"timestamp\": %lld,\n", static_cast<long long>(
+                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+            std::fprintf(out, "    \"compiler\": \"%s\",\n", compiler());
+#ifdef NDEBUG
+            std::fprintf(out, "    \"build_type\": \"release\",\n");
+#else
+            std::fprintf(out, "    \"build_type\": \"debug\",\n");
+#endif
+            std::fprintf(out, "    \"hardware_concurrency\": %u,\n", std::thread::hardware_concurrency());
+            std::fprintf(out, "    \"min_time_ms\": %.1f,\n", m_minTime / 1e6);
+            std::fprintf(out, "    \"repetitions\": %d\n  },\n  \"benchmarks\": [\n", m_repetitions);
+            for (size_t i = 0; i < m_results.size(); ++i) {
+                const Result& r = m_results[i];
+                std::fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"iterations\": %llu}%s\n",
+                    r.name.c_str(), r.nsPerOp, r.minNsPerOp, static_cast<unsigned long long>(r.iterations),
+                    i + 1 < m_results.size() ? "," : "");
+            }
+            std::fprintf(out, "  ]\n}\n");
+
+            if (out != stdout) {
+                std::fclose(out);
+            }
+            return 0;
+        }
+
+    private:
+        static const char* value(const char* arg, const char* prefix) {
+            size_t len = std::strlen(prefix);
+            return std::strncmp(arg, prefix, len) == 0 ? arg + len : nullptr;
+        }
+
+        static const char* compiler() {
+#if defined(__clang__)
+            return "clang " __clang_version__;
+#elif defined(__GNUC__)
+            return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+            return "msvc";
+#else
+            return "unknown";
+#endif
+        }
+
+        std::string m_filter;
+        std::string m_out;
+        double m_minTime = 50e6;
+        int m_repetitions = 3;
+        bool m_json = false;
+        std::vector<Result> m_results;
+    };
+}
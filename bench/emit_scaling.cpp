@@ -0,0 +1,89 @@
+// 多线程同时发送同一个信号的吞吐量，可选一个线程同时连接/断开。
+// g++ -std=c++17 -O2 -I.. emit_scaling.cpp -pthread
+// emit_scaling [max_threads] [milliseconds] [churn(0|1)]
+#include "object.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+struct Receiver : public Object {
+    void onValue(int v) {
+        m_sum.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    std::atomic<long long> m_sum = 0;
+};
+
+struct Sender : public Object {
+    Signal(value, int)
+};
+
+int main(int argc, char** argv) {
+    unsigned hw = std::thread::hardware_concurrency();
+    unsigned maxThreads = argc > 1 ? std::atoi(argv[1]) : (hw ? hw : 4);
+    int milliseconds = argc > 2 ? std::atoi(argv[2]) : 200;
+    bool churn = argc > 3 ? std::atoi(argv[3]) != 0 : true;
+
+    Sender sender;
+    std::vector<Receiver*> receivers;
+    for (int i = 0; i < 8; ++i) {
+        receivers.push_back(new Receiver);
+        sender.value.connect(receivers.back(), &Receiver::onValue, ConnecttionType::Direct);
+    }
+
+    std::printf("%-8s %16s %16s\n", "threads", "emits/s", "emits/s/thread");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        std::atomic<bool> start = false;
+        std::atomic<bool> stop = false;
+        std::vector<long long> counts(threads, 0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                while (!start.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                long long n = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    emit sender.value(1);
+                    ++n;
+                }
+                counts[t] = n;
+            });
+        }
+
+        std::thread writer;
+        if (churn) {
+            writer = std::thread([&] {
+                Receiver extra;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    sender.value.connect(&extra, &Receiver::onValue, ConnecttionType::Direct);
+                    sender.value.disconnect(&extra);
+                }
+            });
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+        stop.store(true);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        if (writer.joinable()) {
+            writer.join();
+        }
+
+        long long total = 0;
+        for (auto n : counts) {
+            total += n;
+        }
+        std::printf("%-8u %16.0f %16.0f\n", threads, total / seconds, total / seconds / threads);
+    }
+
+    for (auto receiver : receivers) {
+        delete receiver;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// fd 就绪到槽被调用的延迟，以及一批就绪事件的分发开销：FdNotifier/FdDispatcher 与手写 epoll 循环对照。
+// 延迟：另一个线程写入时间戳，等槽读出后再写下一个，分别用 pipe 和 socketpair。
+// 分发：fds 个 socketpair 都保持可读（水平触发，不读出），每次 processEvents() 分发一整批，得到每个事件的开销。
+// g++ -std=c++17 -O2 -I.. fd_latency.cpp -pthread
+// fd_latency [messages] [fds]
+#include "fd_notifier.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <sys/socket.h>
+#include <vector>
+
+namespace
+{
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t percentile(std::vector<int64_t>& v, double p) {
+        std::sort(v.begin(), v.end());
+        return v.empty() ? 0 : v[(std::min)(v.size() - 1, static_cast<size_t>(p * v.size()))];
+    }
+
+    bool makePair(const char* transport, int fds[2]) {
+        if (transport[0] == 'p') {
+            return ::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0;
+        }
+        return ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0;
+    }
+
+    // 写线程每次等上一个时间戳被读出后再写，测的是单个事件的延迟而不是排队。
+    template<typename Receive>
+    void measureLatency(const char* name, const char* transport, size_t messages, Receive&& receive) {
+        int fds[2];
+        if (!makePair(transport, fds)) {
+            std::perror(transport);
+            return;
+        }
+
+        std::vector<int64_t> latency;
+        latency.reserve(messages);
+        std::atomic<size_t> received = 0;
+        std::thread writer([&] {
+            for (size_t i = 0; i < messages; ++i) {
+                int64_t ts = now();
+                if (::write(fds[1], &ts, sizeof(ts)) != sizeof(ts)) {
+                    break;
+                }
+                while (received.load(std::memory_order_acquire) <= i) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        auto onReadable = [&](int fd) {
+            int64_t ts;
+            while (::read(fd, &ts, sizeof(ts)) == sizeof(ts)) {
+                latency.push_back(now() - ts);
+                received.fetch_add(1, std::memory_order_release);
+            }
+        };
+        receive(fds[0], onReadable, [&] { return latency.size() < messages; });
+        writer.join();
+        ::close(fds[0]);
+        ::close(fds[1]);
+
+        std::printf("%-12s %-12s %12lld %12lld %12lld\n", name, transport, static_cast<long long>(percentile(latency, 0.5)),
+            static_cast<long long>(percentile(latency, 0.99)), static_cast<long long>(percentile(latency, 0.999)));
+    }
+
+    template<typename OnReadable, typename Running>
+    void receiveNotifier(int fd, OnReadable& onReadable, Running running) {
+        FdDispatcher dispatcher;
+        FdNotifier notifier(&dispatcher, fd, FdNotifier::Read);
+        notifier.activated.connect(onReadable);
+        while (running()) {
+            dispatcher.processEvents(-1);
+        }
+    }
+
+    // 手写的对照：epoll 事件中存放 fd，按 fd 查表调用 std::function。
+    template<typename OnReadable, typename Running>
+    void receiveEpoll(int fd, OnReadable& onReadable, Running running) {
+        int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        std::unordered_map<int, std::function<void(int)>> handlers;
+        handlers[fd] = onReadable;
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev);
+        epoll_event events[256];
+        while (running()) {
+            int n = ::epoll_wait(epoll, events, 256, -1);
+            for (int i = 0; i < n; ++i) {
+                handlers[events[i].data.fd](events[i].data.fd);
+            }
+        }
+        ::close(epoll);
+    }
+
+    template<typename Dispatch>
+    void measureBatch(const char* name, size_t fds, Dispatch&& dispatch) {
+        std::vector<int> pairs(fds * 2);
+        for (size_t i = 0; i < fds; ++i) {
+            if (!makePair("socketpair", &pairs[i * 2])) {
+                std::perror("socketpair");
+                return;
+            }
+            char c = 0;
+            if (::write(pairs[i * 2 + 1], &c, 1) != 1) {
+                std::perror("write");
+                return;
+            }
+        }
+
+        std::vector<int> readable(fds);
+        for (size_t i = 0; i < fds; ++i) {
+            readable[i] = pairs[i * 2];
+        }
+        size_t events = 0;
+        auto begin = std::chrono::steady_clock::now();
+        int rounds = 0;
+        for (; std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(200); ++rounds) {
+            events += dispatch(readable, rounds == 0);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("%-12s %8zu fds %12.1f ns/event %12.1f ns/batch\n", name, fds, ns / events, ns / rounds);
+
+        for (int fd : pairs) {
+            ::close(fd);
+        }
+    }
+
+    void batchNotifier(size_t fds) {
+        FdDispatcher dispatcher(fds);
+        std::vector<std::unique_ptr<FdNotifier>> notifiers;
+        size_t sum = 0;
+        measureBatch("notifier", fds, [&](const std::vector<int>& readable, bool first) {
+            if (first) {
+                for (int fd : readable) {
+                    notifiers.emplace_back(new FdNotifier(&dispatcher, fd, FdNotifier::Read));
+                    notifiers.back()->activated.connect([&sum](int fd) { sum += fd; });
+                }
+            }
+            return dispatcher.processEvents(0);
+        });
+        notifiers.clear();
+    }
+
+    void batchEpoll(size_t fds) {
+        int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        std::unordered_map<int, std::function<void(int)>> handlers;
+        std::vector<epoll_event> events(fds);
+        size_t sum = 0;
+        measureBatch("epoll", fds, [&](const std::vector<int>& readable, bool first) {
+            if (first) {
+                for (int fd : readable) {
+                    handlers[fd] = [&sum](int fd) { sum += fd; };
+                    epoll_event ev{};
+                    ev.events = EPOLLIN;
+                    ev.data.fd = fd;
+                    ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev);
+                }
+            }
+            int n = ::epoll_wait(epoll, events.data(), static_cast<int>(events.size()), 0);
+            for (int i = 0; i < n; ++i) {
+                handlers[events[i].data.fd](events[i].data.fd);
+            }
+            return static_cast<size_t>(n > 0 ? n : 0);
+        });
+        ::close(epoll);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t fds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+
+    std::printf("%-12s %-12s %12s %12s %12s\n", "receiver", "transport", "p50 (ns)", "p99 (ns)", "p99.9 (ns)");
+    for (const char* transport : { "pipe", "socketpair" }) {
+        measureLatency("notifier", transport, messages, [](int fd, auto& onReadable, auto running) {
+            receiveNotifier(fd, onReadable, running);
+        });
+        measureLatency("epoll", transport, messages, [](int fd, auto& onReadable, auto running) {
+            receiveEpoll(fd, onReadable, running);
+        });
+    }
+
+    std::printf("\n");
+    batchNotifier(fds);
+    batchEpoll(fds);
+    return 0;
+}
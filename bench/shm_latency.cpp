@@ -0,0 +1,127 @@
+// 两个进程之间转发信号的延迟：共享内存队列（SharedSignalSender/SharedSignalReceiver）与 socketpair 对照。
+// 父进程发送带时间戳的事件，子进程收到后记录单程延迟并回传，父进程等到回传再发下一个，同时得到往返延迟。
+// g++ -std=c++17 -O2 -I.. shm_latency.cpp -pthread -lrt
+// shm_latency [messages]
+#include "shared_signal.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <vector>
+
+namespace
+{
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Sender : public Object {
+        Signal(tick, int64_t)
+    };
+
+    void report(const char* name, std::vector<int64_t>& oneWay, std::vector<int64_t>& roundTrip) {
+        auto percentile = [](std::vector<int64_t>& v, double p) {
+            std::sort(v.begin(), v.end());
+            return v.empty() ? 0 : v[(std::min)(v.size() - 1, static_cast<size_t>(p * v.size()))];
+        };
+        std::printf("%-12s %12lld %12lld %12lld %12lld %12lld\n", name,
+            static_cast<long long>(percentile(oneWay, 0.5)), static_cast<long long>(percentile(oneWay, 0.99)),
+            static_cast<long long>(percentile(oneWay, 0.999)),
+            static_cast<long long>(percentile(roundTrip, 0.5)), static_cast<long long>(percentile(roundTrip, 0.99)));
+    }
+
+    void benchShm(size_t messages) {
+        std::string request = "/signal_slot_bench_req." + std::to_string(::getpid());
+        std::string reply = "/signal_slot_bench_rep." + std::to_string(::getpid());
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            SharedSignalReceiver<int64_t> in(request);
+            SharedSignalSender<int64_t, int64_t> out(reply);
+            size_t received = 0;
+            in.received.connect([&](int64_t ts) {
+                out.send(ts, now() - ts);
+                ++received;
+            });
+            while (received < messages) {
+                in.wait();
+                in.processEvents();
+            }
+            std::_Exit(0);
+        }
+
+        Sender sender;
+        SharedSignalSender<int64_t> out(sender.tick, request);
+        SharedSignalReceiver<int64_t, int64_t> in(reply);
+        std::vector<int64_t> oneWay, roundTrip;
+        oneWay.reserve(messages);
+        roundTrip.reserve(messages);
+        in.received.connect([&](int64_t ts, int64_t latency) {
+            oneWay.push_back(latency);
+            roundTrip.push_back(now() - ts);
+        });
+        for (size_t i = 0; i < messages; ++i) {
+            emit sender.tick(now());
+            while (roundTrip.size() <= i) {
+                in.wait();
+                in.processEvents();
+            }
+        }
+        ::waitpid(pid, nullptr, 0);
+        removeSharedSignal(request);
+        removeSharedSignal(reply);
+        report("shm", oneWay, roundTrip);
+    }
+
+    void benchSocket(size_t messages) {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            std::perror("socketpair");
+            return;
+        }
+
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(fds[0]);
+            for (size_t i = 0; i < messages; ++i) {
+                int64_t msg[2];
+                if (::read(fds[1], msg, sizeof(int64_t)) != sizeof(int64_t)) {
+                    break;
+                }
+                msg[1] = now() - msg[0];
+                if (::write(fds[1], msg, sizeof(msg)) != sizeof(msg)) {
+                    break;
+                }
+            }
+            std::_Exit(0);
+        }
+
+        ::close(fds[1]);
+        std::vector<int64_t> oneWay, roundTrip;
+        oneWay.reserve(messages);
+        roundTrip.reserve(messages);
+        for (size_t i = 0; i < messages; ++i) {
+            int64_t ts = now();
+            int64_t msg[2];
+            if (::write(fds[0], &ts, sizeof(ts)) != sizeof(ts) || ::read(fds[0], msg, sizeof(msg)) != sizeof(msg)) {
+                break;
+            }
+            oneWay.push_back(msg[1]);
+            roundTrip.push_back(now() - msg[0]);
+        }
+        ::close(fds[0]);
+        ::waitpid(pid, nullptr, 0);
+        report("socketpair", oneWay, roundTrip);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    std::printf("%-12s %12s %12s %12s %12s %12s\n", "transport", "p50 (ns)", "p99 (ns)", "p99.9 (ns)", "rtt p50", "rtt p99");
+    benchShm(messages);
+    benchSocket(messages);
+    return 0;
+}
@@ -0,0 +1,673 @@
+// 发送、连接/断开、嵌套发送、销毁对象树的微基准，以 std::function 数组作为对照。
+#include "object.h"
+#include "bench.h"
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace
+{
+    int g_counter = 0;
+
+    void freeSlot(int v) {
+        g_counter += v;
+    }
+
+    void emptyFunction(int) {
+    }
+
+    // 通过 volatile 函数指针调用，防止被内联，作为没有连接的信号发送的对照。
+    void (*volatile g_emptyFunction)(int) = &emptyFunction;
+
+    struct Receiver : public Object {
+        using Object::Object;
+
+        void onValue(int v) {
+            m_sum += v;
+        }
+
+        void onValues(SignalSpan<int> values) {
+            for (int v : values) {
+                m_sum += v;
+            }
+        }
+
+        Signal(forward, int)
+        int m_sum = 0;
+    };
+
+    struct Sender : public Object {
+        using Object::Object;
+
+        Signal(value, int)
+        Signal(text, std::string)
+        Signal(valueSingle, threading::SingleThreaded, int)
+        Signal(valueMulti, threading::MultiThreaded, int)
+        DeferredSignal(valueDeferred, int)
+    };
+
+    struct Router : public Object {
+        using Object::Object;
+
+        CombinedSignal(accept, combiner::FirstTrue, int)
+        CombinedSignal(collect, combiner::Collect<int>, int)
+    };
+
+    struct Functor {
+        int* sum;
+        void operator()(int v) const {
+            *sum += v;
+        }
+    };
+
+    const size_t kSlotCounts[] = { 1, 8, 1000 };
+
+    void benchBaseline(bench::Runner& runner) {
+        for (size_t count : { size_t(0), size_t(1), size_t(8), size_t(1000) }) {
+            int sum = 0;
+            std::vector<std::function<void(int)>> handlers;
+            for (size_t i = 0; i < count; ++i) {
+                handlers.emplace_back([&sum](int v) { sum += v; });
+            }
+
+            runner.run("baseline/std_function_vector/" + std::to_string(count), [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    for (auto& handler : handlers) {
+                        handler(1);
+                    }
+                }
+                bench::doNotOptimize(sum);
+            });
+        }
+
+        runner.run("baseline/empty_function_call", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                g_emptyFunction(1);
+            }
+        });
+    }
+
+    void benchEmit(bench::Runner& runner) {
+        {
+            Sender sender;
+            runner.run("emit/empty/0", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.value(1);
+                }
+            });
+        }
+        {
+            Sender sender;
+            Receiver receiver;
+            sender.value.connect(&receiver, &Receiver::onValue);
+            sender.value.disconnect(&receiver, &Receiver::onValue);
+            runner.run("emit/disconnected/0", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.value(1);
+                }
+            });
+        }
+
+        for (size_t count : kSlotCounts) {
+            auto suffix = "/" + std::to_string(count);
+            {
+                Sender sender;
+                for (size_t i = 0; i < count; ++i) {
+                    sender.value.connect(&freeSlot);
+                }
+                runner.run("emit/function" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                    bench::doNotOptimize(g_counter);
+                });
+            }
+            {
+                Sender sender;
+                std::vector<std::unique_ptr<Receiver>> receivers;
+                for (size_t i = 0; i < count; ++i) {
+                    receivers.emplace_back(new Receiver);
+                    sender.value.connect(receivers.back().get(), &Receiver::onValue);
+                }
+                runner.run("emit/member_function" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                });
+            }
+            {
+                Sender sender;
+                std::vector<std::unique_ptr<Receiver>> receivers;
+                for (size_t i = 0; i < count; ++i) {
+                    receivers.emplace_back(new Receiver);
+                    sender.value.connect<&Receiver::onValue>(receivers.back().get());
+                }
+                runner.run("emit/static_member_function" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                });
+            }
+            {
+                Sender sender;
+                int sum = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    sender.value.connect(Functor{ &sum });
+                }
+                runner.run("emit/function_object" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                    bench::doNotOptimize(sum);
+                });
+            }
+            {
+                Sender sender;
+                std::vector<std::unique_ptr<Receiver>> receivers;
+                for (size_t i = 0; i < count; ++i) {
+                    receivers.emplace_back(new Receiver);
+                    sender.value.connect(receivers.back().get(), &Receiver::forward);
+                }
+                runner.run("emit/signal" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                });
+            }
+        }
+    }
+
+    // 槽在编译期固定的 StaticSignal，与 emit/function、emit/static_member_function 对照。
+    // 槽被内联后循环可以整体折叠，每次发送后用 clobberMemory 保留。
+    void benchStatic(bench::Runner& runner) {
+        {
+            StaticSignal<void(int), &freeSlot> signal{ nullptr, nullptr };
+            runner.run("emit_static/function/1", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit signal(1);
+                    bench::clobberMemory();
+                }
+                bench::doNotOptimize(g_counter);
+            });
+        }
+        {
+            Receiver r;
+            StaticSignal<void(int), &Receiver::onValue> signal{ nullptr, &r };
+            runner.run("emit_static/member_function/1", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit signal(1);
+                    bench::clobberMemory();
+                }
+                bench::doNotOptimize(r.m_sum);
+            });
+        }
+        {
+            Receiver r[8];
+            constexpr auto slot = &Receiver::onValue;
+            StaticSignal<void(int), slot, slot, slot, slot, slot, slot, slot, slot> signal{ nullptr, &r[0], &r[1], &r[2], &r[3], &r[4], &r[5], &r[6], &r[7] };
+            runner.run("emit_static/member_function/8", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit signal(1);
+                    bench::clobberMemory();
+                }
+                bench::doNotOptimize(r[7].m_sum);
+            });
+        }
+    }
+
+    // 同一个信号分别使用单线程和多线程模型。单线程模型发送时不做原子同步。
+    void benchPolicy(bench::Runner& runner) {
+        for (size_t count : { size_t(1), size_t(8) }) {
+            auto suffix = "/" + std::to_string(count);
+            Sender sender;
+            std::vector<std::unique_ptr<Receiver>> receivers;
+            for (size_t i = 0; i < count; ++i) {
+                receivers.emplace_back(new Receiver);
+                sender.valueSingle.connect(receivers.back().get(), &Receiver::onValue);
+                sender.valueMulti.connect(receivers.back().get(), &Receiver::onValue);
+            }
+            runner.run("emit_policy/multi_threaded" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.valueMulti(1);
+                }
+            });
+            runner.run("emit_policy/single_threaded" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.valueSingle(1);
+                }
+            });
+        }
+    }
+
+    // 按值接收 std::string 的槽。右值发送时最后一个槽移动参数，左值发送时每个槽复制一次。
+    void benchEmitString(bench::Runner& runner) {
+        const std::string text(64, 'x');
+        for (size_t count : { size_t(1), size_t(8) }) {
+            auto suffix = "/" + std::to_string(count);
+            Sender sender;
+            size_t length = 0;
+            for (size_t i = 0; i < count; ++i) {
+                sender.text.connect([&length](std::string s) { length += s.size(); });
+            }
+            runner.run("emit_string/lvalue" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.text(text);
+                }
+                bench::doNotOptimize(length);
+            });
+            runner.run("emit_string/rvalue" + suffix, [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.text(std::string(text));
+                }
+                bench::doNotOptimize(length);
+            });
+        }
+    }
+
+    // 大扇出。连接与其他 15 个信号的连接随机交错创建，模拟长时间运行后分散在堆上的连接块。
+    void benchFanout(bench::Runner& runner) {
+        for (size_t count : { size_t(1000), size_t(100000) }) {
+            auto suffix = "/" + std::to_string(count);
+            std::mt19937 rng(42);
+            int sum = 0;
+            {
+                std::vector<Sender> others(15);
+                Sender sender;
+                for (size_t i = 0; i < count; ++i) {
+                    for (size_t k = rng() % 31; k > 0; --k) {
+                        others[rng() % others.size()].value.connect([&sum](int v) { sum -= v; });
+                    }
+                    sender.value.connect([&sum](int v) { sum += v; });
+                }
+                runner.run("emit_fanout/lambda" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                    bench::doNotOptimize(sum);
+                });
+            }
+            {
+                std::vector<Sender> others(15);
+                Sender sender;
+                std::vector<std::unique_ptr<Receiver>> receivers;
+                for (size_t i = 0; i < count; ++i) {
+                    receivers.emplace_back(new Receiver);
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    for (size_t k = rng() % 31; k > 0; --k) {
+                        others[rng() % others.size()].value.connect(receivers[rng() % count].get(), &Receiver::onValue);
+                    }
+                    sender.value.connect<&Receiver::onValue>(receivers[i].get());
+                }
+                runner.run("emit_fanout/static_member_function" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        emit sender.value(1);
+                    }
+                });
+            }
+        }
+    }
+
+#ifndef SIGNAL_SLOT_SINGLE_THREADED
+    // 8 个计算量较大的槽，Direct 在发送线程依次执行，Parallel 分散到 ThreadPool::global()。
+    // 单线程模型下不使用线程池，不编译这一组。
+    void benchParallel(bench::Runner& runner) {
+        auto work = [](int v) {
+            uint64_t x = v;
+            for (int i = 0; i < 20000; ++i) {
+                x = x * 6364136223846793005ull + 1442695040888963407ull;
+            }
+            bench::doNotOptimize(x);
+        };
+        for (auto type : { ConnecttionType::Direct, ConnecttionType::Parallel }) {
+            Sender sender;
+            for (int i = 0; i < 8; ++i) {
+                sender.value.connect(work, type);
+            }
+            auto name = type == ConnecttionType::Direct ? "direct" : "parallel";
+            runner.run(std::string("emit_heavy/") + name + "/8", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.value(1);
+                }
+            });
+        }
+    }
+#endif
+
+    // 1000 个处理者，只有第 10 个接受。FirstTrue 在接受后停止，Collect 调用全部槽，手写版本用共享状态记录结果。
+    void benchCombiner(bench::Runner& runner) {
+        const int count = 1000;
+        const int accepted = 10;
+        {
+            Router router;
+            for (int i = 0; i < count; ++i) {
+                router.accept.connect([i](int v) { return i == v; });
+            }
+            runner.run("emit_combiner/first_true/1000", [&](uint64_t n) {
+                bool result = false;
+                for (uint64_t i = 0; i < n; ++i) {
+                    result ^= emit router.accept(accepted);
+                }
+                bench::doNotOptimize(result);
+            });
+        }
+        {
+            Router router;
+            for (int i = 0; i < count; ++i) {
+                router.collect.connect([i](int v) { return i == v ? 1 : 0; });
+            }
+            runner.run("emit_combiner/collect/1000", [&](uint64_t n) {
+                size_t size = 0;
+                for (uint64_t i = 0; i < n; ++i) {
+                    size += (emit router.collect(accepted)).size();
+                }
+                bench::doNotOptimize(size);
+            });
+        }
+        {
+            Sender sender;
+            bool handled = false;
+            for (int i = 0; i < count; ++i) {
+                sender.value.connect([i, &handled](int v) {
+                    if (!handled && i == v) {
+                        handled = true;
+                    }
+                });
+            }
+            runner.run("emit_combiner/manual_flag/1000", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    handled = false;
+                    emit sender.value(accepted);
+                }
+                bench::doNotOptimize(handled);
+            });
+        }
+    }
+
+    void benchConnect(bench::Runner& runner) {
+        {
+            Sender sender;
+            Receiver receiver;
+            runner.run("connect_disconnect/member_function", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    sender.value.connect(&receiver, &Receiver::onValue);
+                    sender.value.disconnect(&receiver);
+                }
+            });
+        }
+        {
+            Sender sender;
+            int sum = 0;
+            runner.run("connect_disconnect/function_object", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    sender.value.connect([&sum](int v) { sum += v; });
+                    sender.value.disconnect();
+                }
+            });
+        }
+        {
+            Sender sender;
+            int sum = 0;
+            runner.run("connect_disconnect/handle", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    sender.value.connect([&sum](int v) { sum += v; }).disconnect();
+                }
+            });
+        }
+        {
+            Sender sender;
+            runner.run("connect_disconnect/function_by_slot", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    sender.value.connect(&freeSlot);
+                    sender.value.disconnect(&freeSlot);
+                }
+            });
+        }
+        {
+            runner.runTimed("connect/member_function/1000", [&](uint64_t n) {
+                double elapsed = 0;
+                for (uint64_t i = 0; i < n; ++i) {
+                    Sender sender;
+                    Receiver receiver;
+                    auto begin = std::chrono::steady_clock::now();
+                    for (int j = 0; j < 1000; ++j) {
+                        sender.value.connect(&receiver, &Receiver::onValue);
+                    }
+                    elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+                }
+                return elapsed;
+            });
+        }
+
+        {
+            runner.runTimed("connect_unique/build/1000", [&](uint64_t n) {
+                double elapsed = 0;
+                for (uint64_t i = 0; i < n; ++i) {
+                    Sender sender;
+                    std::vector<std::unique_ptr<Receiver>> receivers;
+                    for (int j = 0; j < 1000; ++j) {
+                        receivers.emplace_back(new Receiver);
+                    }
+                    auto begin = std::chrono::steady_clock::now();
+                    for (auto& receiver : receivers) {
+                        sender.value.connect(receiver.get(), &Receiver::onValue, ConnecttionType::Unique);
+                    }
+                    elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+                }
+                return elapsed;
+            });
+        }
+
+        for (size_t count : { size_t(8), size_t(100), size_t(1000) }) {
+            Sender sender;
+            std::vector<std::unique_ptr<Receiver>> receivers;
+            for (size_t i = 0; i < count; ++i) {
+                receivers.emplace_back(new Receiver);
+                sender.value.connect(receivers.back().get(), &Receiver::onValue);
+            }
+            Receiver* last = receivers.back().get();
+            runner.run("connect_unique/existing/" + std::to_string(count), [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    sender.value.connect(last, &Receiver::onValue, ConnecttionType::Unique);
+                }
+            });
+        }
+    }
+
+    void benchNested(bench::Runner& runner) {
+        for (int depth : { 2, 8 }) {
+            std::vector<std::unique_ptr<Sender>> chain;
+            for (int i = 0; i < depth; ++i) {
+                chain.emplace_back(new Sender);
+            }
+            for (int i = 0; i + 1 < depth; ++i) {
+                Sender* next = chain[i + 1].get();
+                chain[i]->value.connect(next, [next](int v) { emit next->value(v); });
+            }
+            int sum = 0;
+            chain.back()->value.connect([&sum](int v) { sum += v; });
+
+            runner.run("nested_emit/depth/" + std::to_string(depth), [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit chain.front()->value(1);
+                }
+                bench::doNotOptimize(sum);
+            });
+        }
+
+        {
+            Sender sender;
+            int sum = 0;
+            sender.value.connect([&sender](int v) {
+                if (v > 0) {
+                    emit sender.value(v - 1);
+                }
+            });
+            sender.value.connect([&sum](int v) { sum += v; });
+            runner.run("nested_emit/recursive/4", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    emit sender.value(4);
+                }
+                bench::doNotOptimize(sum);
+            });
+        }
+    }
+
+    // 一个数据包中的 500 个事件：逐个发送、emitBatch 逐个槽调用、emitBatch 整批交给 connectBatch 的槽。
+    void benchBatch(bench::Runner& runner) {
+        std::vector<int> events(500);
+        for (size_t i = 0; i < events.size(); ++i) {
+            events[i] = static_cast<int>(i);
+        }
+
+        for (int mode = 0; mode < 3; ++mode) {
+            Sender sender;
+            Receiver receivers[8];
+            for (auto& receiver : receivers) {
+                if (mode == 2) {
+                    sender.value.connectBatch(&receiver, &Receiver::onValues);
+                }
+                else {
+                    sender.value.connect(&receiver, &Receiver::onValue);
+                }
+            }
+            const char* names[] = { "emit_batch/loop/8/500", "emit_batch/slot_major/8/500", "emit_batch/batch_slot/8/500" };
+            runner.run(names[mode], [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    if (mode == 0) {
+                        for (int v : events) {
+                            emit sender.value(v);
+                        }
+                    }
+                    else {
+                        sender.value.emitBatch(events);
+                    }
+                }
+                bench::doNotOptimize(receivers[0].m_sum);
+            });
+        }
+    }
+
+    // 一次 flush 之间发送 burst 次：普通信号每次都调用 8 个槽，DeferredSignal 只保存参数，flush 时调用一次。
+    void benchDeferred(bench::Runner& runner) {
+        for (int burst : { 1, 1000 }) {
+            auto suffix = "/8/burst/" + std::to_string(burst);
+            {
+                Sender sender;
+                Receiver receivers[8];
+                for (auto& receiver : receivers) {
+                    sender.value.connect(&receiver, &Receiver::onValue);
+                }
+                runner.run("emit_deferred/immediate" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        for (int j = 0; j < burst; ++j) {
+                            emit sender.value(j);
+                        }
+                    }
+                    bench::doNotOptimize(receivers[0].m_sum);
+                });
+            }
+            {
+                Sender sender;
+                Receiver receivers[8];
+                for (auto& receiver : receivers) {
+                    sender.valueDeferred.connect(&receiver, &Receiver::onValue);
+                }
+                auto loop = EventLoop::current();
+                runner.run("emit_deferred/coalesced" + suffix, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; ++i) {
+                        for (int j = 0; j < burst; ++j) {
+                            emit sender.valueDeferred(j);
+                        }
+                        loop->flushDeferred();
+                    }
+                    bench::doNotOptimize(receivers[0].m_sum);
+                });
+            }
+        }
+    }
+
+    // 时间轮：启动/停止是 O(1)；advance 处理的 tick 数与到期的定时器个数成正比，不随等待中的定时器增多。
+    void benchTimer(bench::Runner& runner) {
+        {
+            TimerWheel wheel;
+            Timer timer(&wheel);
+            timer.timeout.connect([] {});
+            runner.run("timer/start_stop", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i) {
+                    timer.start(1 + (i & 0xffff));
+                    timer.stop();
+                }
+            });
+        }
+
+        for (int pending : { 0, 100000 }) {
+            TimerWheel wheel;
+            Object root;
+            for (int i = 0; i < pending; ++i) {
+                auto timer = new Timer(&wheel, &root);
+                timer->timeout.connect([] {});
+                timer->start(uint64_t(1) << 31);
+            }
+            int fired = 0;
+            Timer timer(&wheel);
+            timer.timeout.connect([&fired] { ++fired; });
+            timer.start(1);
+            runner.run("timer/fire/pending/" + std::to_string(pending), [&](uint64_t n) {
+                wheel.advance(n);
+                bench::doNotOptimize(fired);
+            });
+        }
+    }
+
+    void benchDestroy(bench::Runner& runner) {
+        for (int size : { 100, 1000 }) {
+            for (int fanout : { 0, 8 }) {
+                auto name = "destroy_tree/" + std::to_string(size) + "/cross_connections/" + std::to_string(fanout);
+                runner.runTimed(name, [&](uint64_t n) {
+                    double elapsed = 0;
+                    std::mt19937 rng(42);
+                    for (uint64_t i = 0; i < n; ++i) {
+                        auto root = new Receiver;
+                        std::vector<Receiver*> nodes{ root };
+                        for (int j = 1; j < size; ++j) {
+                            nodes.push_back(new Receiver(nodes[rng() % nodes.size()]));
+                        }
+                        for (auto node : nodes) {
+                            for (int k = 0; k < fanout; ++k) {
+                                node->forward.connect(nodes[rng() % nodes.size()], &Receiver::onValue);
+                            }
+                        }
+
+                        auto begin = std::chrono::steady_clock::now();
+                        delete root;
+                        elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+                    }
+                    return elapsed;
+                });
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Runner runner(argc, argv);
+    benchBaseline(runner);
+    benchEmit(runner);
+    benchStatic(runner);
+    benchPolicy(runner);
+    benchEmitString(runner);
+    benchFanout(runner);
+#ifndef SIGNAL_SLOT_SINGLE_THREADED
+    benchParallel(runner);
+#endif
+    benchCombiner(runner);
+    benchConnect(runner);
+    benchNested(runner);
+    benchBatch(runner);
+    benchDeferred(runner);
+    benchTimer(runner);
+    benchDestroy(runner);
+    return runner.finish();
+}
@@ -0,0 +1,257 @@
+﻿#pragma once
+#include "object.h"
+#include <cassert>
+#include <cerrno>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(__linux__)
+#error "fd_notifier.h requires Linux (epoll)."
+#endif
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/// <summary>
+/// 文件描述符就绪时发送信号。
+/// FdNotifier notifier(&dispatcher, fd, FdNotifier::Read) 在 fd 可读时发送 activated(fd)，FdNotifier::Write 在可写时发送。
+/// FdDispatcher 持有一个 epoll 实例，processEvents() 一次 epoll_wait 取出一批就绪事件并依次发送，事件数组预先分配，
+/// epoll 事件中直接存放 fd 的登记项，分发时不查表、不分配内存。
+/// 水平触发：槽没有读完（或写满）时下一次 processEvents() 再次发送。出错或对端关闭时读、写两个方向都会发送。
+/// 同一个 fd 在一个分发器中最多有一个 Read 和一个 Write 通知器。setEnabled(false) 暂停通知，析构（包括随父对象析构）时自动注销。
+/// 分发器和它的通知器只在一个线程中使用；槽中可以创建、禁用、删除通知器，但不能删除分发器或在槽中调用 processEvents()。
+/// </summary>
+class FdNotifier;
+
+class FdDispatcher {
+public:
+    explicit FdDispatcher(size_t maxEvents = 256) : m_events(maxEvents ? maxEvents : 1) {
+        m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll < 0) {
+            throw std::system_error(errno, std::system_category(), "epoll_create1");
+        }
+    }
+
+    FdDispatcher(const FdDispatcher&) = delete;
+    FdDispatcher& operator=(const FdDispatcher&) = delete;
+
+    ~FdDispatcher();
+
+    /// epoll 实例的描述符，可以放进其他事件循环中等待。
+    int fd() const noexcept {
+        return m_epoll;
+    }
+
+    /// 等待就绪事件（毫秒，0 不阻塞，负数不超时），发送这一批中所有通知器的 activated。返回发送的次数。
+    /// 一批取满 maxEvents 个时剩下的事件留给下一次调用。
+    size_t processEvents(int timeoutMs = 0);
+
+private:
+    friend class FdNotifier;
+
+    // 一个 fd 的登记项。epoll 事件中存放它的地址；unordered_map 的元素在插入其他元素时不移动。
+    struct Entry {
+        FdNotifier* notifiers[2] = {};
+        uint32_t events = 0;
+    };
+
+    void add(FdNotifier* notifier);
+    void remove(FdNotifier* notifier) noexcept;
+    void update(int fd, Entry& entry);
+
+    int m_epoll = -1;
+    bool m_dispatching = false;
+    std::vector<epoll_event> m_events;
+    std::unordered_map<int, Entry> m_entries;
+    // 分发过程中清空的登记项，这一批后面的事件还可能指向它们，分发结束后再删除。
+    std::vector<int> m_released;
+};
+
+/// <summary>
+/// fd 就绪时发送 activated(fd)。不拥有 fd，关闭 fd 之前先删除或禁用通知器。
+/// </summary>
+class FdNotifier : public Object {
+public:
+    enum Type {
+        Read = 0,
+        Write = 1,
+    };
+
+    /// 登记到 dispatcher 并启用。同一个 fd 已有同类型的通知器，或 epoll_ctl 失败时抛出 std::system_error。
+    FdNotifier(FdDispatcher* dispatcher, int fd, Type type, Object* parent = nullptr)
+        : Object(parent), m_dispatcher(dispatcher), m_fd(fd), m_type(type) {
+        if (m_dispatcher) {
+            m_dispatcher->add(this);
+        }
+    }
+
+    ~FdNotifier() {
+        if (m_dispatcher) {
+            m_dispatcher->remove(this);
+        }
+    }
+
+    int socket() const noexcept {
+        return m_fd;
+    }
+
+    Type type() const noexcept {
+        return m_type;
+    }
+
+    bool isEnabled() const noexcept {
+        return m_enabled;
+    }
+
+    /// 禁用后这一批中还没有发送的事件也不再发送。
+    void setEnabled(bool enabled) {
+        if (m_enabled == enabled) {
+            return;
+        }
+        m_enabled = enabled;
+        if (m_dispatcher) {
+            try {
+                m_dispatcher->update(m_fd, m_dispatcher->m_entries[m_fd]);
+            }
+            catch (...) {
+                m_enabled = !enabled;
+                throw;
+            }
+        }
+    }
+
+    Signal(activated, int)
+
+private:
+    friend class FdDispatcher;
+
+    FdDispatcher* m_dispatcher;
+    int m_fd;
+    Type m_type;
+    bool m_enabled = true;
+};
+
+inline FdDispatcher::~FdDispatcher() {
+    assert(!m_dispatching && "FdDispatcher destroyed from an activated slot.");
+    for (auto& item : m_entries) {
+        for (auto notifier : item.second.notifiers) {
+            if (notifier) {
+                notifier->m_dispatcher = nullptr;
+            }
+        }
+    }
+    ::close(m_epoll);
+}
+
+inline void FdDispatcher::add(FdNotifier* notifier) {
+    Entry& entry = m_entries[notifier->m_fd];
+    if (entry.notifiers[notifier->m_type]) {
+        throw std::system_error(EEXIST, std::system_category(), "FdNotifier");
+    }
+    entry.notifiers[notifier->m_type] = notifier;
+    try {
+        update(notifier->m_fd, entry);
+    }
+    catch (...) {
+        entry.notifiers[notifier->m_type] = nullptr;
+        if (!entry.notifiers[1 - notifier->m_type] && !m_dispatching) {
+            m_entries.erase(notifier->m_fd);
+        }
+        throw;
+    }
+}
+
+inline void FdDispatcher::remove(FdNotifier* notifier) noexcept {
+    auto it = m_entries.find(notifier->m_fd);
+    if (it == m_entries.end() || it->second.notifiers[notifier->m_type] != notifier) {
+        return;
+    }
+    Entry& entry = it->second;
+    entry.notifiers[notifier->m_type] = nullptr;
+    try {
+        update(notifier->m_fd, entry);
+    }
+    catch (...) {
+        // fd 已经被关闭时 epoll 已自动移除它，忽略。
+    }
+    if (!entry.notifiers[0] && !entry.notifiers[1]) {
+        if (m_dispatching) {
+            m_released.push_back(notifier->m_fd);
+        }
+        else {
+            m_entries.erase(it);
+        }
+    }
+}
+
+// 按启用的通知器重新设置 epoll 关注的事件。都没有启用时从 epoll 中移除，否则出错或挂断会一直就绪。
+inline void FdDispatcher::update(int fd, Entry& entry) {
+    uint32_t events = 0;
+    if (entry.notifiers[FdNotifier::Read] && entry.notifiers[FdNotifier::Read]->m_enabled) {
+        events |= EPOLLIN;
+    }
+    if (entry.notifiers[FdNotifier::Write] && entry.notifiers[FdNotifier::Write]->m_enabled) {
+        events |= EPOLLOUT;
+    }
+    if (events == entry.events) {
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.ptr = &entry;
+    int op = !entry.events ? EPOLL_CTL_ADD : events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    if (::epoll_ctl(m_epoll, op, fd, &ev) != 0) {
+        throw std::system_error(errno, std::system_category(), "epoll_ctl");
+    }
+    entry.events = events;
+}
+
+inline size_t FdDispatcher::processEvents(int timeoutMs) {
+    assert(!m_dispatching && "FdDispatcher::processEvents() called from an activated slot.");
+    int n;
+    do {
+        n = ::epoll_wait(m_epoll, m_events.data(), static_cast<int>(m_events.size()), timeoutMs);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return 0;
+    }
+
+    struct Dispatching {
+        FdDispatcher* self;
+        ~Dispatching() {
+            self->m_dispatching = false;
+            for (int fd : self->m_released) {
+                auto it = self->m_entries.find(fd);
+                if (it != self->m_entries.end() && !it->second.notifiers[0] && !it->second.notifiers[1]) {
+                    self->m_entries.erase(it);
+                }
+            }
+            self->m_released.clear();
+        }
+    } dispatching{ this };
+    m_dispatching = true;
+
+    size_t count = 0;
+    for (int i = 0; i < n; ++i) {
+        auto entry = static_cast<Entry*>(m_events[i].data.ptr);
+        uint32_t events = m_events[i].events;
+        // 每次发送前重新读取通知器，前一个槽可能删除或禁用了它。
+        if (events & (EPOLLIN | EPOLLPRI | EPOLLHUP | EPOLLERR)) {
+            FdNotifier* notifier = entry->notifiers[FdNotifier::Read];
+            if (notifier && notifier->m_enabled) {
+                ++count;
+                emit notifier->activated(notifier->m_fd);
+            }
+        }
+        if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+            FdNotifier* notifier = entry->notifiers[FdNotifier::Write];
+            if (notifier && notifier->m_enabled) {
+                ++count;
+                emit notifier->activated(notifier->m_fd);
+            }
+        }
+    }
+    return count;
+}
@@ -4,14 +4,47 @@
 #include <utility>
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <tuple>
 #include <cassert>
+#include <cstdint>
+#include <new>
+#include <memory_resource>
+#include <unordered_map>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <chrono>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define OBJECT_HAS_COROUTINES 1
+#endif
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+#endif
 
 /// <summary>
-/// 暂不支持多线程。
 /// 发送信号或接收信号的类需要继承自 Object。
 /// 在类中使用 Signal(signal_name, type1, type2, ...) 定义信号。
 /// 发生信号 emit this->signal_name(arg1, arg2)。
-/// 支持Unique连接。
+/// CombinedSignal(signal_name, combiner, type1, ...) 定义带返回值的信号，combiner 合并槽的返回值，
+/// 例如 combiner::FirstTrue 在第一个返回 true 的槽之后停止发送。
+/// C++20 下 co_await this->signal_name 挂起协程直到下一次发送，得到参数副本组成的 std::optional<std::tuple<...>>，信号析构时为空。
+/// 连接固定不变时 StaticSignal<void(type1, ...), &Class::func, ...> 在编译期绑定所有槽，发送展开为直接调用。
+/// 编译时定义 SIGNAL_SLOT_INSTRUMENTATION 时记录每处信号声明的发送次数、扇出、嵌套深度和槽耗时直方图，signalStatisticsJson() 导出；未定义时没有任何开销。
+/// signal_name.emitBatch(count, array1, ...) 一次发送 count 个事件，逐个槽遍历；signal_name.connectBatch(obj, slot) 连接的槽以 SignalSpan<T> 整批接收。
+/// DeferredSignal(signal_name, type1, ...) 的发送只保存最后一次的参数，在发送者线程的 EventLoop::flushDeferred()（processEvents() 结束时）或 signal_name.flush() 时发送一次。
+/// Signal(signal_name, threading::SingleThreaded, type1, ...) 的信号发送时不做原子同步，只能在一个线程中使用；定义 SIGNAL_SLOT_SINGLE_THREADED 时所有信号默认如此。
+/// Timer 是由 TimerWheel（分层时间轮）驱动的定时器，到期发送 timeout，TimerWheel::advance(n) 手动前进。
+/// 支持Unique连接。连接较多的信号在第一次按槽查找时建立 (接收者, 槽) 的哈希索引，Unique 连接和 disconnect(obj, slot) 不需要遍历所有连接。
 /// 
 /// 连接信号使用
 /// this->signal_name.connect(slot)
@@ -21,6 +54,13 @@
 /// 可以连接成员函数，信号，Lambda，函数对象，普通函数指针, 重载了转换成函数指针的类对象。
 /// 在obj对象析构时，此信号槽连接会自动断开。
 /// 
+/// connect(..., type, priority) 指定优先级，发送时优先级高的槽先调用，相同优先级按连接顺序。
+/// 发送过程中建立的连接从下一次发送开始按优先级排列。
+/// 
+/// this->signal_name.connect<&Class::func>(obj)
+/// this->signal_name.connect<&func>()
+/// 成员函数或普通函数作为模板参数在编译期绑定，连接中不存放函数指针，调用可以被内联。
+/// 
 /// 断开信号
 /// this->disconnect()
 /// 断开this连接的所有信号。
@@ -40,9 +80,29 @@
 /// this->signal_name.disconnect(obj, slot)
 /// 断开此信号与某个槽的单个连接。(通过 this->signal_name.connect(obj, slot) 连接的槽， 槽对象必须是可以比较相等的)。
 /// 
+/// this->signal_name.disconnect<&Class::func>(obj)
+/// this->signal_name.disconnect<&func>()
+/// 断开编译期绑定的单个连接。
+/// 
+/// connect 返回 ConnectionHandle，handle.disconnect() 以 O(1) 断开这一个连接，不要求槽可以比较相等。
+/// handle.setBlocked(true) 暂时阻塞连接，发送信号时跳过。ScopedConnection 在析构时断开连接。
+/// 
 /// Object* sender() 
 /// 获取当前的信号 sender
 /// 
+/// 多线程
+/// 每个 Object 属于创建它的线程的 EventLoop，可以用 obj->moveToThread(loop) 改变。
+/// ConnecttionType::Auto 在接收者与发送线程相同时直接调用，否则按 Queued 处理。
+/// ConnecttionType::Queued 复制参数后投递到接收者线程的 EventLoop，由 exec()/processEvents() 调用槽。
+/// ConnecttionType::BlockingQueued 投递到接收者线程并等待槽执行完成。
+/// ConnecttionType::Parallel 在 ThreadPool::global() 中与同一次发送的其他槽并行执行，发送返回前等待完成。
+/// 没有接收者的连接以发送者所在线程为准。
+/// 信号可以在多个线程同时发送、连接和断开，发送时不加锁。
+/// 
+/// 内存
+/// 没有连接过的信号只占一个指针，第一次连接时才分配连接数据，Object 本身为 64 字节。
+/// 可以平凡复制的槽对象在连接数组中连续存放一份副本，发送时顺序读取，不访问 Connection。
+/// 
 /// 辅助方法
 /// overload<>
 /// constOverload<>
@@ -52,17 +112,59 @@
 
 
 class Object;
+class EventLoop;
 
 enum class ConnecttionType {
     Auto = 0,
     Direct = 1,
-    //Queued = 2,
-    //BlockingQueued = 4,
+    Queued = 2,
+    BlockingQueued = 4,
     Unique = 8,
+    Parallel = 16,
 };
 
+constexpr ConnecttionType operator|(ConnecttionType a, ConnecttionType b) noexcept {
+    return static_cast<ConnecttionType>(static_cast<int>(a) | static_cast<int>(b));
+}
+
+/// <summary>
+/// 信号发送的线程模型。Signal(name, threading::SingleThreaded, type1, ...) 为单个信号指定，
+/// 不指定时为 threading::Default：定义了 SIGNAL_SLOT_SINGLE_THREADED 时是 SingleThreaded，否则是 MultiThreaded。
+/// SingleThreaded 的信号发送时只用普通的读写标记正在发送，不做原子同步，要求它的连接、断开、发送和接收者的析构都在同一个线程中。
+/// 定义 SIGNAL_SLOT_SINGLE_THREADED 时整个库只在一个线程中使用，纪元记录也不再是 thread_local。
+/// 当前发送者仍是 thread_local：Parallel 连接的槽在线程池中调用，各自设置 sender()。
+/// </summary>
+namespace threading
+{
+    struct SingleThreaded {};
+    struct MultiThreaded {};
+
+#ifdef SIGNAL_SLOT_SINGLE_THREADED
+    using Default = SingleThreaded;
+#else
+    using Default = MultiThreaded;
+#endif
+}
+
+#ifdef SIGNAL_SLOT_SINGLE_THREADED
+#define OBJECT_THREAD_LOCAL
+#else
+#define OBJECT_THREAD_LOCAL thread_local
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OBJECT_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define OBJECT_NOINLINE __declspec(noinline)
+#else
+#define OBJECT_NOINLINE
+#endif
+
 namespace objectImpl
 {
+    template<typename...>
+    inline constexpr bool dependent_false = false;
+
     template<typename ...Args>
     struct List {
         static constexpr size_t size = sizeof...(Args);
@@ -89,7 +191,7 @@ namespace objectImpl
             return Types{};
         }
         else if constexpr (N == 1 && Types::size < 1) {
-            static_assert(false, "A compilation error has occurred somewhere ahead.");
+            static_assert(dependent_false<Types>, "A compilation error has occurred somewhere ahead.");
             return List<>{};
         }
         else {
@@ -113,6 +215,64 @@ namespace objectImpl
         :public std::true_type {
     };
 
+    template<typename T>
+    struct MoveArg {};
+
+    // 从参数数组中取出参数。MoveArg<T> 表示按值传递的参数以右值交给槽。
+    template<typename T>
+    struct Argument {
+        static std::remove_reference_t<T>& get(void* p) noexcept {
+            return *reinterpret_cast<std::remove_reference_t<T>*>(p);
+        }
+    };
+
+    template<typename T>
+    struct Argument<MoveArg<T>> {
+        static decltype(auto) get(void* p) noexcept {
+            if constexpr (std::is_reference_v<T>) {
+                return Argument<T>::get(p);
+            }
+            else {
+                return std::move(Argument<T>::get(p));
+            }
+        }
+    };
+
+    template<typename Types>
+    struct MoveArgs;
+
+    template<typename... T>
+    struct MoveArgs<List<T...>> {
+        using type = List<MoveArg<T>...>;
+        using Rvalues = List<std::conditional_t<std::is_reference_v<T>, T, T&&>...>;
+    };
+
+    template<typename T>
+    inline constexpr char slotTypeTag = 0;
+
+    // 槽的标识哈希，相等的槽哈希相同。函数指针和成员指针按值计算，其他可比较的函数对象只区分类型。
+    // 不可比较的槽返回 0，这样的槽不会与任何连接相等。
+    template<typename Slot>
+    size_t slotHash(const Slot& slot) noexcept {
+        using T = std::decay_t<Slot>;
+        if constexpr (!hasEqualOperator<T>::value) {
+            return 0;
+        }
+        else {
+            size_t h = reinterpret_cast<size_t>(&slotTypeTag<T>);
+            if constexpr (std::is_pointer_v<T> || std::is_member_pointer_v<T>) {
+                const T value = slot;
+                size_t words[(sizeof(T) + sizeof(size_t) - 1) / sizeof(size_t)] = {};
+                std::memcpy(words, &value, sizeof(T));
+                for (size_t word : words) {
+                    h = (h ^ word) * 0x100000001b3ull;
+                    h ^= h >> 29;
+                }
+            }
+            return h | 1;
+        }
+    }
+
     template <typename... Args1, typename... Args2>
     constexpr bool checkCompatibleArguments(List<Args1...>, List<Args2...>)
     {
@@ -168,14 +328,33 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::FuncionObject;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType& func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            func((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType& func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return func(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
     template<typename... Args>
     class SignalImpl;
 
+    template<typename... Args>
+    class DeferredSignalImpl;
+
+    // 信号作为槽时的参数，不包括线程模型。
+    template<typename... Args>
+    struct SignalArguments {
+        using type = List<Args...>;
+    };
+
+    template<typename... Args>
+    struct SignalArguments<threading::SingleThreaded, Args...> {
+        using type = List<Args...>;
+    };
+
+    template<typename... Args>
+    struct SignalArguments<threading::MultiThreaded, Args...> {
+        using type = List<Args...>;
+    };
+
     template<typename Obj, typename ...Args>
     struct CallableObject<SignalImpl<Args...> Obj::*>
     {
@@ -183,12 +362,12 @@ namespace objectImpl
 
         using FunctionType = SignalImpl<Args...> Obj::*;
         using ObjectType = Obj;
-        using ArguementTypes = List<Args...>;
+        using ArguementTypes = typename SignalArguments<Args...>::type;
         static constexpr CallableObjectType callableOjectType = CallableObjectType::Signal;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*sig)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*sig)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -199,12 +378,44 @@ namespace objectImpl
 
         using FunctionType = const SignalImpl<Args...> Obj::*;
         using ObjectType = const Obj;
+        using ArguementTypes = typename SignalArguments<Args...>::type;
+        static constexpr CallableObjectType callableOjectType = CallableObjectType::Signal;
+
+        template<size_t... Index, typename... SigArgs>
+        static decltype(auto) call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*sig)(Argument<SigArgs>::get(arg[Index])...);
+        }
+    };
+
+    template<typename Obj, typename ...Args>
+    struct CallableObject<DeferredSignalImpl<Args...> Obj::*>
+    {
+        static constexpr bool isCallable = std::is_base_of_v<Object, Obj>;
+
+        using FunctionType = DeferredSignalImpl<Args...> Obj::*;
+        using ObjectType = Obj;
+        using ArguementTypes = List<Args...>;
+        static constexpr CallableObjectType callableOjectType = CallableObjectType::Signal;
+
+        template<size_t... Index, typename... SigArgs>
+        static decltype(auto) call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*sig)(Argument<SigArgs>::get(arg[Index])...);
+        }
+    };
+
+    template<typename Obj, typename ...Args>
+    struct CallableObject<const DeferredSignalImpl<Args...> Obj::*>
+    {
+        static constexpr bool isCallable = std::is_base_of_v<Object, Obj>;
+
+        using FunctionType = const DeferredSignalImpl<Args...> Obj::*;
+        using ObjectType = const Obj;
         using ArguementTypes = List<Args...>;
         static constexpr CallableObjectType callableOjectType = CallableObjectType::Signal;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*sig)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType sig, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*sig)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -219,8 +430,8 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::MemberFuncion;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*func)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*func)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -235,8 +446,8 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::MemberFuncion;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*func)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*func)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -251,8 +462,8 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::MemberFuncion;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*func)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*func)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -267,8 +478,8 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::MemberFuncion;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            (obj->*func)((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return (obj->*func)(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -282,8 +493,8 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::Function;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            func((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return func(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
@@ -297,296 +508,2820 @@ namespace objectImpl
         static constexpr CallableObjectType callableOjectType = CallableObjectType::Function;
 
         template<size_t... Index, typename... SigArgs>
-        static void call(FunctionType func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
-            func((*reinterpret_cast<std::remove_reference_t<SigArgs>*>(arg[Index]))...);
+        static decltype(auto) call(FunctionType func, ObjectType*, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            return func(Argument<SigArgs>::get(arg[Index])...);
         }
     };
 
-    class SlotObjectBase {
-        // don't use virtual functions here; we don't want the
-        // compiler to create tons of per-polymorphic-class stuff that
-        // we'll never need. We just use one function pointer.
-        typedef void (*ImplFn)(int which, SlotObjectBase* this_, Object* receiver, void** args, bool* ret);
-        ImplFn const m_impl;
-    protected:
-        enum Operation {
-            Call,
-            Compare,
-        };
-    public:
-        explicit SlotObjectBase(ImplFn fn) : m_impl(fn) {}
-        inline bool compare(void** a) { bool ret = false; m_impl(Compare, this, nullptr, a, &ret); return ret; }
-        inline void call(Object* r, void** a) { m_impl(Call, this, r, a, nullptr); }
-        ~SlotObjectBase() {}
+    // 编译期绑定的槽：函数指针作为模板参数，调用可以被内联，连接中不存放函数指针。
+    template<auto Func>
+    struct StaticSlot {
+        constexpr bool operator==(const StaticSlot&) const noexcept {
+            return true;
+        }
     };
 
-    template<typename Func, typename SigArgs>
-    class SlotObject : public SlotObjectBase
+    template<auto Func>
+    struct CallableObject<StaticSlot<Func>>
     {
-        Func function;
-        static void impl(int which, SlotObjectBase* this_, Object* recv, void** a, bool* ret)
-        {
-            SlotObject* _this = static_cast<SlotObject*>(this_);
-            switch (which) {
-            case Call:
-                using FunctionInfo = CallableObject<Func>;
-                FunctionInfo::call(_this->function, static_cast<typename FunctionInfo::ObjectType*>(recv), a
-                    , SigArgs{}, std::make_index_sequence<SigArgs::size>());
-                break;
-            case Compare:
-                if constexpr (hasEqualOperator<Func>::value) {
-                    *ret = *reinterpret_cast<Func*>(a) == _this->function;
-                }
+        using FunctionInfo = CallableObject<decltype(Func)>;
+        static constexpr bool isCallable = FunctionInfo::isCallable
+            && (FunctionInfo::callableOjectType == CallableObjectType::MemberFuncion || FunctionInfo::callableOjectType == CallableObjectType::Function);
+        using FunctionType = StaticSlot<Func>;
+        using ObjectType = typename FunctionInfo::ObjectType;
+        using ArguementTypes = typename FunctionInfo::ArguementTypes;
+        static constexpr CallableObjectType callableOjectType = FunctionInfo::callableOjectType;
+
+        template<size_t... Index, typename... SigArgs>
+        static decltype(auto) call(FunctionType, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            if constexpr (callableOjectType == CallableObjectType::MemberFuncion) {
+                return (obj->*Func)(Argument<SigArgs>::get(arg[Index])...);
+            }
+            else {
+                return Func(Argument<SigArgs>::get(arg[Index])...);
             }
         }
+    };
+
+    // emitBatch() 中一个参数的连续数组，只读。C++20 下可以从 std::span 构造，也可以转换为 std::span。
+    template<typename T>
+    class Span
+    {
     public:
-        template<typename T>
-        explicit SlotObject(T&& f) : SlotObjectBase(&impl), function(std::forward<T>(f)) {
+        constexpr Span() noexcept = default;
+        constexpr Span(const T* data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+        // std::vector、std::array、std::span 等提供 data() 和 size() 的连续容器。
+        template<typename Container, typename = std::enable_if_t<
+            std::is_convertible_v<decltype(std::declval<const Container&>().data()), const T*>
+            && std::is_convertible_v<decltype(std::declval<const Container&>().size()), size_t>>>
+        constexpr Span(const Container& c) noexcept : m_data(c.data()), m_size(c.size()) {}
+
+#ifdef __cpp_lib_span
+        constexpr operator std::span<const T>() const noexcept {
+            return { m_data, m_size };
         }
+#endif
+
+        constexpr const T* data() const noexcept { return m_data; }
+        constexpr size_t size() const noexcept { return m_size; }
+        constexpr bool empty() const noexcept { return m_size == 0; }
+        constexpr const T* begin() const noexcept { return m_data; }
+        constexpr const T* end() const noexcept { return m_data + m_size; }
+        constexpr const T& operator[](size_t i) const noexcept { return m_data[i]; }
+
+    private:
+        const T* m_data = nullptr;
+        size_t m_size = 0;
     };
 
-    struct Connection
+    // connectBatch() 连接的槽：参数是每个信号参数的 Span。emitBatch() 时整批调用一次，普通发送时以长度为 1 的 Span 调用。
+    template<typename Func, typename... T>
+    struct BatchSlot {
+        Func func;
+    };
+
+    template<typename Func, typename... T>
+    struct CallableObject<BatchSlot<Func, T...>>
     {
-        Connection(Object* sender, const Object* recver, SlotObjectBase* slot)
-            :sender(sender), recver(const_cast<Object*>(recver)), slot(slot)
-        {
+        using FunctionInfo = CallableObject<Func>;
+        static constexpr bool isMember = FunctionInfo::callableOjectType == CallableObjectType::MemberFuncion;
+        static constexpr bool isCallable = FunctionInfo::isCallable && FunctionInfo::callableOjectType != CallableObjectType::Signal
+            && (isMember ? std::is_invocable_v<Func, typename FunctionInfo::ObjectType*, Span<T>...> : std::is_invocable_v<Func&, Span<T>...>);
+        using FunctionType = BatchSlot<Func, T...>;
+        using ObjectType = typename FunctionInfo::ObjectType;
+        static constexpr CallableObjectType callableOjectType = FunctionInfo::callableOjectType;
+
+        template<size_t... Index, typename... SigArgs>
+        static void call(FunctionType& slot, ObjectType* obj, void** arg, List<SigArgs...>, std::index_sequence<Index...>) {
+            invoke(slot, obj, Span<T>(&Argument<SigArgs>::get(arg[Index]), 1)...);
         }
 
-        ~Connection() {
-            delete slot;
-            slot = nullptr;
+        // spans[i] 指向第 i 个参数的 Span。
+        template<size_t... Index>
+        static void callBatch(FunctionType& slot, ObjectType* obj, void** spans, std::index_sequence<Index...>) {
+            invoke(slot, obj, *static_cast<const Span<T>*>(spans[Index])...);
         }
 
-        bool release() {
-            int expect = 2;
-            if (!ref.compare_exchange_strong(expect, 1)) {
-                if (expect == 1) {
-                    if (ref.compare_exchange_strong(expect, 0)) {
-                        delete this;
-                        return true;
-                    }
-                }
+    private:
+        static void invoke(FunctionType& slot, ObjectType* obj, Span<T>... spans) {
+            if constexpr (isMember) {
+                (obj->*slot.func)(spans...);
+            }
+            else {
+                slot.func(spans...);
             }
-            return false;
         }
-
-        std::atomic<int> ref = 2;
-        Object* recver = nullptr;
-        Object* sender = nullptr;
-        SlotObjectBase* slot = nullptr;
     };
 
-    inline static thread_local Object* g_currentSender = nullptr;
-    struct SenderGuard {
-        explicit SenderGuard(Object* sender) noexcept {
-            old_sender = g_currentSender;
-            g_currentSender = sender;
-        }
+    template<typename Func>
+    struct isBatchSlot : public std::false_type {
+    };
 
-        ~SenderGuard() noexcept {
-            g_currentSender = old_sender;
-        }
-        Object* old_sender = nullptr;
+    template<typename Func, typename... T>
+    struct isBatchSlot<BatchSlot<Func, T...>> : public std::true_type {
     };
 
-    struct Utils
-    {
-        inline static bool addConnection(Object* obj, Connection* conn);
+    template<typename... Args>
+    constexpr bool acceptsRvalues(List<Args...>) {
+        return (... && !(std::is_lvalue_reference_v<Args> && !std::is_const_v<std::remove_reference_t<Args>>));
+    }
 
-        static void addChild(std::vector<Object*>& chidren, Object* chid) {
-            if (!chidren.empty() && chidren.size() == chidren.capacity()) {
-                auto iter = std::remove(chidren.begin(), chidren.end(), nullptr);
-                chidren.erase(iter, chidren.end());
-            }
+    // 槽能否接受被移动的参数。参数为非 const 左值引用的槽仍然按左值调用。
+    template<typename Func, typename SigArgs, typename = void>
+    struct canCallMoved :public canInvokable<Func&, typename MoveArgs<SigArgs>::Rvalues> {
+    };
 
-            chidren.push_back(chid);
+    template<typename Func, typename SigArgs>
+    struct canCallMoved<Func, SigArgs, std::void_t<typename CallableObject<Func>::ArguementTypes>>
+        :public std::bool_constant<acceptsRvalues(typename CallableObject<Func>::ArguementTypes{})> {
+    };
 
-            if (chidren.capacity() / 2 > chidren.size()) {
-                auto tmp = chidren;
-                tmp.swap(chidren);
-            }
-        }
+    struct QueuedSlotCallBase;
 
-        static void addConnection(std::vector<Connection*>& conns, Connection* conn) {
-            if (!conns.empty() && conns.size() == conns.capacity()) {
-                int count = 0;
-                for (auto& item : conns) {
-                    if (!item) {
-                        ++count;
-                        continue;
-                    }
+    template<typename... Args>
+    struct QueuedSlotCall;
 
-                    if (item && item->ref == 1) {
-                        item->release();
-                        item = nullptr;
-                        ++count;
-                    }
-                }
+    class SlotObjectBase {
+        // don't use virtual functions here; we don't want the
+        // compiler to create tons of per-polymorphic-class stuff that
+        // we'll never need. We just use one function pointer.
+        typedef void (*ImplFn)(int which, SlotObjectBase* this_, Object* receiver, void** args, void* ret);
+        template<typename, typename, typename> friend class SlotObject;
+    protected:
+        enum Operation {
+            Call,
+            CallMove,
+            Compare,
+            Queue,
+            QueueMove,
+            Destroy,
+            Hash,
+            Clone,
+            CallBatch,
+        };
+    public:
+        // 槽对象不超过 InlineSize 时直接存放在 Connection 中，否则存放指向堆上对象的指针。
+        static constexpr size_t InlineSize = 3 * sizeof(void*);
 
-                if (count > conns.size() * 0.2) {
-                    auto iter = std::remove(conns.begin(), conns.end(), nullptr);
-                    conns.erase(iter, conns.end());
-                }
-            }
+        SlotObjectBase() noexcept = default;
+        SlotObjectBase(const SlotObjectBase&) = delete;
+        SlotObjectBase& operator=(const SlotObjectBase&) = delete;
+        ~SlotObjectBase() { if (m_impl) m_impl(Destroy, this, nullptr, nullptr, nullptr); }
 
-            conns.push_back(conn);
+        inline bool compare(void** a) { bool ret = false; m_impl(Compare, this, nullptr, a, &ret); return ret; }
+        // move 为 true 时按值传递的参数以右值传给槽，调用之后参数可能已被移走。
+        // ret 不为空时槽的返回值构造在 ret 中，只用于带返回值的信号。
+        inline void call(Object* r, void** a, bool move = false, void* ret = nullptr) { m_impl(move ? CallMove : Call, this, r, a, ret); }
+        // 复制（move 为 true 时移动）参数，生成投递到其他线程的调用事件。参数不可复制时返回 nullptr。
+        inline QueuedSlotCallBase* queue(void** a, bool move = false) { QueuedSlotCallBase* ret = nullptr; m_impl(move ? QueueMove : Queue, this, nullptr, a, &ret); return ret; }
+        inline size_t hash() { size_t ret = 0; m_impl(Hash, this, nullptr, nullptr, &ret); return ret; }
+        // 槽对象可以平凡复制、存放在内部并且不会被调用修改时复制到 dst，否则 dst 保持为空。
+        inline void cloneTo(SlotObjectBase& dst) { m_impl(Clone, this, nullptr, nullptr, &dst); }
+        // connectBatch() 连接的槽以整批参数调用一次并返回 true，其他槽返回 false。spans[i] 指向第 i 个参数的 Span。
+        inline bool callBatch(Object* r, void** spans) { bool ret = false; m_impl(CallBatch, this, r, spans, &ret); return ret; }
+        bool empty() const noexcept { return !m_impl; }
 
-            if (conns.capacity() / 2 > conns.size()) {
-                auto tmp = conns;
-                tmp.swap(conns);
-            }
-        }
+    private:
+        ImplFn m_impl = nullptr;
+        alignas(void*) unsigned char m_storage[InlineSize];
     };
 
-    class SignalImplBase
+    // Ret 不为 void 时槽属于带返回值的信号，调用时 ret 不为空则把返回值转换为 Ret 构造在 ret 中。
+    template<typename Func, typename SigArgs, typename Ret = void>
+    class SlotObject
     {
-    public:
-        SignalImplBase(const SignalImplBase&) = delete;
-        SignalImplBase& operator=(const SignalImplBase&) = delete;
-        explicit SignalImplBase(Object* parent) noexcept :m_parent(parent) {}
+        static constexpr bool isInline = sizeof(Func) <= SlotObjectBase::InlineSize && alignof(Func) <= alignof(void*);
+        static constexpr bool isClonable = isInline && std::is_trivially_copyable_v<Func>
+            && (CallableObject<Func>::callableOjectType != CallableObjectType::FuncionObject || canInvokable<const Func&, SigArgs>::value);
 
-        ~SignalImplBase() {
-            disconnect();
-            assert(m_nested == 0);
+        static Func& function(SlotObjectBase* this_) noexcept {
+            if constexpr (isInline) {
+                return *std::launder(reinterpret_cast<Func*>(this_->m_storage));
+            }
+            else {
+                return **reinterpret_cast<Func**>(this_->m_storage);
+            }
         }
 
-        bool disconnect() {
-            for (auto& conn : m_conns) {
-                if (conn) {
-                    if (!conn->recver) {
-                        delete conn;
-                    }
-                    else {
-                        conn->release();
-                    }
-                    conn = nullptr;
+        template<bool Move, size_t... Index, typename... Args>
+        static QueuedSlotCallBase* makeQueuedCall(void** a, List<Args...>, std::index_sequence<Index...>) {
+            if constexpr ((... && std::is_copy_constructible_v<remove_rcv_t<Args>>)) {
+                using Call = QueuedSlotCall<remove_rcv_t<Args>...>;
+                if constexpr (Move) {
+                    return new Call(Argument<MoveArg<Args>>::get(a[Index])...);
+                }
+                else {
+                    return new Call(Argument<Args>::get(a[Index])...);
                 }
             }
-
-            return !m_conns.empty();
+            else {
+                return nullptr;
+            }
         }
 
-        bool disconnect(const Object* obj) {
-            bool res = false;
-            for (auto& conn : m_conns) {
-                if (conn && conn->recver == obj) {
-                    conn->release();
-                    conn = nullptr;
-                    res = true;
+        template<typename ArgTypes>
+        static void invoke(SlotObjectBase* this_, Object* recv, void** a, void* ret) {
+            using FunctionInfo = CallableObject<Func>;
+            auto obj = static_cast<typename FunctionInfo::ObjectType*>(recv);
+            if constexpr (!std::is_void_v<Ret>) {
+                using SlotRet = decltype(FunctionInfo::call(function(this_), obj, a, ArgTypes{}, std::make_index_sequence<SigArgs::size>()));
+                static_assert(std::is_convertible_v<SlotRet, Ret>, "The slot's return type is not convertible to the signal's result type.");
+                if (ret) {
+                    new (ret) Ret(FunctionInfo::call(function(this_), obj, a, ArgTypes{}, std::make_index_sequence<SigArgs::size>()));
+                    return;
                 }
             }
-            return res;
+            FunctionInfo::call(function(this_), obj, a, ArgTypes{}, std::make_index_sequence<SigArgs::size>());
         }
 
-    protected:
-        void invokeSlots(void** args) {
-            SenderGuard sender(m_parent);
-            size_t count = 0;
-            ++m_nested;
-            for (auto& conn : m_conns) {
-                if (!conn) {
-                    ++count;
-                    continue;
+        static void impl(int which, SlotObjectBase* this_, Object* recv, void** a, void* ret)
+        {
+            switch (which) {
+            case SlotObjectBase::Call:
+                invoke<SigArgs>(this_, recv, a, ret);
+                break;
+            case SlotObjectBase::CallMove:
+                invoke<std::conditional_t<canCallMoved<Func, SigArgs>::value, typename MoveArgs<SigArgs>::type, SigArgs>>(this_, recv, a, ret);
+                break;
+            case SlotObjectBase::Compare:
+                if constexpr (hasEqualOperator<Func>::value) {
+                    *static_cast<bool*>(ret) = *reinterpret_cast<Func*>(a) == function(this_);
                 }
-
-                if (conn->ref == 2) {
-                    conn->slot->call(conn->recver, args);
+                break;
+            case SlotObjectBase::Queue:
+                *static_cast<QueuedSlotCallBase**>(ret) = makeQueuedCall<false>(a, SigArgs{}, std::make_index_sequence<SigArgs::size>());
+                break;
+            case SlotObjectBase::QueueMove:
+                *static_cast<QueuedSlotCallBase**>(ret) = makeQueuedCall<true>(a, SigArgs{}, std::make_index_sequence<SigArgs::size>());
+                break;
+            case SlotObjectBase::Destroy:
+                if constexpr (isInline) {
+                    function(this_).~Func();
                 }
                 else {
-                    if (conn->release()) {
-                        conn = nullptr;
-                        ++count;
-                    }
+                    delete &function(this_);
                 }
-            }
-
-            --m_nested;
-            if (m_nested == 0) {
-                if (count > m_conns.size() * 0.2) {
-                    auto iter = std::remove(m_conns.begin(), m_conns.end(), (Connection*)(nullptr));
-                    m_conns.erase(iter, m_conns.end());
+                break;
+            case SlotObjectBase::Hash:
+                *static_cast<size_t*>(ret) = slotHash(function(this_));
+                break;
+            case SlotObjectBase::Clone:
+                if constexpr (isClonable) {
+                    create(*static_cast<SlotObjectBase*>(ret), function(this_));
                 }
-
-                if (m_waitForConns && !m_waitForConns->empty()) {
-                    for (auto& conn : *m_waitForConns) {
-                        m_conns.push_back(conn);
-                    }
-                    delete m_waitForConns;
-                    m_waitForConns = nullptr;
+                break;
+            case SlotObjectBase::CallBatch:
+                if constexpr (isBatchSlot<Func>::value) {
+                    using FunctionInfo = CallableObject<Func>;
+                    FunctionInfo::callBatch(function(this_), static_cast<typename FunctionInfo::ObjectType*>(recv), a, std::make_index_sequence<SigArgs::size>());
+                    *static_cast<bool*>(ret) = true;
                 }
+                break;
             }
         }
-
-        bool isConnectionExist(const Object* obj, void** arg) const {
-            for (auto& conn : m_conns) {
-                if (conn && conn->recver == obj && conn->ref == 2 && conn->slot->compare(arg)) {
-                    return true;
-                }
+    public:
+        template<typename T>
+        static void create(SlotObjectBase& slot, T&& f) {
+            assert(!slot.m_impl);
+            if constexpr (isInline) {
+                new (slot.m_storage) Func(std::forward<T>(f));
             }
-
-            return false;
+            else {
+                *reinterpret_cast<Func**>(slot.m_storage) = new Func(std::forward<T>(f));
+            }
+            slot.m_impl = &impl;
         }
+    };
 
-        bool disconnectImpl(const Object* obj, void** arg) {
-            bool res = false;
-            for (auto& conn : m_conns) {
-                if (conn && conn->recver == obj && conn->ref == 2 && conn->slot->compare(arg)) {
-                    conn->release();
-                    conn = nullptr;
-                    res = true;
-                    break;
+    class SpinLock
+    {
+    public:
+        void lock() noexcept {
+            while (m_locked.exchange(true, std::memory_order_acquire)) {
+                while (m_locked.load(std::memory_order_relaxed)) {
+                    std::this_thread::yield();
                 }
             }
-            return res;
         }
 
-        bool createConnectImpl(const Object* obj, SlotObjectBase* slotObj, ConnecttionType type = ConnecttionType::Auto) {
-            auto conn = new Connection(m_parent, obj, slotObj);
-            if (obj) {
-                Utils::addConnection(const_cast<Object*>(obj), conn);
-            }
-
-            if (m_nested == 0) {
-                Utils::addConnection(m_conns, conn);
-            }
-            else {
-                if (!m_waitForConns) {
-                    m_waitForConns = new std::vector<Connection*>{};
-                }
-                m_waitForConns->push_back(conn);
-            }
+        bool try_lock() noexcept {
+            return !m_locked.load(std::memory_order_relaxed) && !m_locked.exchange(true, std::memory_order_acquire);
+        }
 
-            return true;
+        void unlock() noexcept {
+            m_locked.store(false, std::memory_order_release);
         }
 
     private:
-        size_t m_nested = 0;
-        std::vector<Connection*> m_conns;
-        std::vector<Connection*>* m_waitForConns = nullptr;
-        Object* const m_parent;
+        std::atomic<bool> m_locked = false;
     };
 
-    template<typename... Args>
-    class SignalImpl : public SignalImplBase
+    // 固定大小内存块的池。每个线程缓存一部分空闲块，缓存过多时归还全局空闲链表。
+    template<size_t BlockSize, size_t BlockAlign>
+    class FixedBlockPool
     {
-        using SigArgs = List<Args...>;
+        struct FreeBlock {
+            FreeBlock* next;
+        };
 
-    public:
-        using SignalImplBase::SignalImplBase;
+        struct Chunk {
+            Chunk* next;
+        };
 
-        void operator()(Args...args) const {
-            const_cast<SignalImpl*>(this)->operator()(args...);
-        }
+        enum class CacheState : unsigned char {
+            Uninitialized,
+            Alive,
+            Destroyed,
+        };
+
+        struct ThreadCache {
+            FreeBlock* head = nullptr;
+            size_t count = 0;
+            CacheState state = CacheState::Uninitialized;
+        };
+
+        struct ThreadCacheHolder {
+            ~ThreadCacheHolder() {
+                FixedBlockPool::instance().releaseBlocks(FixedBlockPool::s_cache.count);
+                FixedBlockPool::s_cache.state = CacheState::Destroyed;
+            }
+        };
+
+        static constexpr size_t Size = (BlockSize + BlockAlign - 1) / BlockAlign * BlockAlign;
+        static constexpr size_t ChunkBlocks = 64;
+        static constexpr size_t BatchSize = 32;
+        static constexpr size_t MaxCached = 256;
+        static constexpr size_t HeaderSize = (sizeof(Chunk) + BlockAlign - 1) / BlockAlign * BlockAlign;
+
+    public:
+        static_assert(BlockSize >= sizeof(FreeBlock) && BlockAlign >= alignof(FreeBlock));
+
+        static FixedBlockPool& instance() noexcept {
+            static FixedBlockPool pool;
+            return pool;
+        }
+
+        void* allocate() {
+            ThreadCache& cache = s_cache;
+            if (!cache.head) {
+                initCache(cache);
+                refill(cache);
+            }
+
+            FreeBlock* block = cache.head;
+            cache.head = block->next;
+            --cache.count;
+            return block;
+        }
+
+        void deallocate(void* p) noexcept {
+            ThreadCache& cache = s_cache;
+            auto block = static_cast<FreeBlock*>(p);
+            if (cache.state != CacheState::Alive) {
+                initCache(cache);
+            }
+
+            if (cache.state == CacheState::Destroyed) {
+                std::lock_guard<SpinLock> lock(m_lock);
+                block->next = m_free;
+                m_free = block;
+                return;
+            }
+
+            block->next = cache.head;
+            cache.head = block;
+            if (++cache.count > MaxCached) {
+                releaseBlocks(MaxCached / 2);
+            }
+        }
+
+    private:
+        static void initCache(ThreadCache& cache) noexcept {
+            if (cache.state == CacheState::Uninitialized) {
+                static thread_local ThreadCacheHolder holder;
+                cache.state = CacheState::Alive;
+            }
+        }
+
+        void refill(ThreadCache& cache) {
+            std::lock_guard<SpinLock> lock(m_lock);
+            if (!m_free) {
+                auto chunk = static_cast<Chunk*>(::operator new(HeaderSize + Size * ChunkBlocks, std::align_val_t(BlockAlign)));
+                chunk->next = m_chunks;
+                m_chunks = chunk;
+                auto base = reinterpret_cast<unsigned char*>(chunk) + HeaderSize;
+                for (size_t i = ChunkBlocks; i-- > 0;) {
+                    auto block = reinterpret_cast<FreeBlock*>(base + i * Size);
+                    block->next = m_free;
+                    m_free = block;
+                }
+            }
+
+            for (size_t i = 0; i < BatchSize && m_free; ++i) {
+                FreeBlock* block = m_free;
+                m_free = block->next;
+                block->next = cache.head;
+                cache.head = block;
+                ++cache.count;
+            }
+        }
+
+        void releaseBlocks(size_t count) noexcept {
+            ThreadCache& cache = s_cache;
+            std::lock_guard<SpinLock> lock(m_lock);
+            while (count-- > 0 && cache.head) {
+                FreeBlock* block = cache.head;
+                cache.head = block->next;
+                --cache.count;
+                block->next = m_free;
+                m_free = block;
+            }
+        }
+
+        inline static thread_local ThreadCache s_cache;
+
+        SpinLock m_lock;
+        FreeBlock* m_free = nullptr;
+        Chunk* m_chunks = nullptr;
+    };
+
+    struct Connection
+    {
+        // 连接数组中状态字节的取值。
+        enum : uint8_t {
+            StateAlive = 1,
+            StateBlocked = 2,
+        };
+
+        Connection(Object* sender, const Object* recver) noexcept
+            :ref(recver ? 2 : 1), recver(const_cast<Object*>(recver)), sender(sender)
+        {
+        }
+
+        // 信号端与接收者端各持有一个引用，投递中的事件另外各持有一个。
+        void addRef() noexcept {
+            ref.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool deref() noexcept {
+            if (ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+                return true;
+            }
+            return false;
+        }
+
+        bool release() noexcept {
+            disconnect();
+            return deref();
+        }
+
+        // 断开连接，同时清除连接数组中的状态。返回之前是否处于连接状态。
+        bool disconnect() noexcept {
+            std::lock_guard<SpinLock> lock(stateLock);
+            bool res = connected.exchange(false, std::memory_order_relaxed);
+            if (state) {
+                state->store(0, std::memory_order_relaxed);
+            }
+            return res;
+        }
+
+        bool setBlocked(bool block) noexcept {
+            std::lock_guard<SpinLock> lock(stateLock);
+            bool res = blocked.exchange(block, std::memory_order_relaxed);
+            if (state) {
+                state->store(flags(), std::memory_order_relaxed);
+            }
+            return res;
+        }
+
+        // 设置连接在连接数组中的状态字节，需持有信号的锁。
+        // 数组在所有连接换到新位置之后才回收，持有 stateLock 时 state 总是有效的。
+        void attach(std::atomic<uint8_t>* s) noexcept {
+            std::lock_guard<SpinLock> lock(stateLock);
+            state = s;
+            if (state) {
+                state->store(flags(), std::memory_order_relaxed);
+            }
+        }
+
+        // 状态字节是否还是 s，需持有信号的锁。
+        bool attachedTo(const std::atomic<uint8_t>* s) const noexcept {
+            return state == s;
+        }
+
+        uint8_t flags() const noexcept {
+            if (!connected.load(std::memory_order_relaxed)) {
+                return 0;
+            }
+            return blocked.load(std::memory_order_relaxed) ? StateAlive | StateBlocked : StateAlive;
+        }
+
+        static void* operator new(size_t size);
+        static void operator delete(void* p) noexcept;
+
+        std::atomic<int> ref;
+        std::atomic<bool> connected = true;
+        std::atomic<bool> blocked = false;
+        SpinLock stateLock;
+        std::atomic<uint8_t>* state = nullptr;
+        Object* recver = nullptr;
+        Object* sender = nullptr;
+        SlotObjectBase slot;
+    };
+
+    static_assert(sizeof(Connection) <= 64, "Connection should fit in one cache line");
+
+    using ConnectionPool = FixedBlockPool<sizeof(Connection), alignof(Connection)>;
+
+    inline void* Connection::operator new(size_t size) {
+        assert(size == sizeof(Connection));
+        static_cast<void>(size);
+        return ConnectionPool::instance().allocate();
+    }
+
+    inline void Connection::operator delete(void* p) noexcept {
+        ConnectionPool::instance().deallocate(p);
+    }
+
+    // 总是 thread_local，SIGNAL_SLOT_SINGLE_THREADED 下线程池中的 Parallel 槽也会设置它。
+    inline static thread_local Object* g_currentSender = nullptr;
+    struct SenderGuard {
+        explicit SenderGuard(Object* sender) noexcept {
+            old_sender = g_currentSender;
+            g_currentSender = sender;
+        }
+
+        ~SenderGuard() noexcept {
+            g_currentSender = old_sender;
+        }
+        Object* old_sender = nullptr;
+    };
+
+    struct QueuedEvent
+    {
+        // exec 为 false 时只释放事件，不执行（所属 EventLoop 被销毁）。
+        typedef void (*ImplFn)(QueuedEvent* this_, bool exec);
+
+        explicit QueuedEvent(ImplFn fn) noexcept : m_impl(fn) {}
+        void run() { m_impl(this, true); }
+        void discard() { m_impl(this, false); }
+
+        std::atomic<QueuedEvent*> next = nullptr;
+    private:
+        ImplFn const m_impl;
+    };
+
+    // 无锁多生产者单消费者队列 (Vyukov intrusive MPSC)。
+    class MpscQueue
+    {
+    public:
+        MpscQueue() noexcept : m_head(&m_stub), m_tail(&m_stub) {}
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        void push(QueuedEvent* ev) noexcept {
+            ev->next.store(nullptr, std::memory_order_relaxed);
+            QueuedEvent* prev = m_head.exchange(ev);
+            prev->next.store(ev, std::memory_order_release);
+        }
+
+        // 只能由消费者线程调用。生产者正在入队时可能暂时返回 nullptr，此时 empty() 为 false。
+        QueuedEvent* pop() noexcept {
+            QueuedEvent* tail = m_tail;
+            QueuedEvent* next = tail->next.load(std::memory_order_acquire);
+            if (tail == &m_stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                m_tail = next;
+                tail = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next) {
+                m_tail = next;
+                return tail;
+            }
+
+            if (tail != m_head.load()) {
+                return nullptr;
+            }
+
+            push(&m_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (next) {
+                m_tail = next;
+                return tail;
+            }
+            return nullptr;
+        }
+
+        bool empty() const noexcept {
+            return m_tail == &m_stub && m_stub.next.load(std::memory_order_acquire) == nullptr && m_head.load() == &m_stub;
+        }
+
+    private:
+        std::atomic<QueuedEvent*> m_head;
+        QueuedEvent* m_tail;
+        QueuedEvent m_stub{ nullptr };
+    };
+
+    struct QueuedSlotCallBase : public QueuedEvent
+    {
+        using QueuedEvent::QueuedEvent;
+        Connection* conn = nullptr;
+    };
+
+    template<typename... Args>
+    struct QueuedSlotCall : public QueuedSlotCallBase
+    {
+        template<typename... T>
+        explicit QueuedSlotCall(T&&... a) : QueuedSlotCallBase(&impl), args(std::forward<T>(a)...) {}
+
+        std::tuple<Args...> args;
+
+    private:
+        template<size_t... Index>
+        void invoke(std::index_sequence<Index...>) {
+            void* _a[] = { reinterpret_cast<void*>(&std::get<Index>(args))..., 0 };
+            SenderGuard sender(conn->sender);
+            // 参数属于这个事件并且只使用一次。
+            conn->slot.call(conn->recver, _a, true);
+        }
+
+        static void impl(QueuedEvent* this_, bool exec) {
+            auto _this = static_cast<QueuedSlotCall*>(this_);
+            if (exec && _this->conn->connected.load(std::memory_order_acquire)) {
+                _this->invoke(std::index_sequence_for<Args...>());
+            }
+            _this->conn->deref();
+            delete _this;
+        }
+    };
+
+    // 在发送线程的栈上构造，参数无需复制，发送线程等待槽执行完成。
+    struct BlockingSlotCall : public QueuedEvent
+    {
+        BlockingSlotCall(Connection* conn, void** args, void* ret) noexcept : QueuedEvent(&impl), conn(conn), args(args), ret(ret) {}
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return done; });
+        }
+
+        Connection* conn;
+        void** args;
+        void* ret;
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool done = false;
+        bool called = false;
+
+    private:
+        static void impl(QueuedEvent* this_, bool exec) {
+            auto _this = static_cast<BlockingSlotCall*>(this_);
+            if (exec && _this->conn->connected.load(std::memory_order_acquire)) {
+                SenderGuard sender(_this->conn->sender);
+                _this->conn->slot.call(_this->conn->recver, _this->args, false, _this->ret);
+                _this->called = true;
+            }
+            std::lock_guard<std::mutex> lock(_this->mutex);
+            _this->done = true;
+            _this->cond.notify_one();
+        }
+    };
+
+    template<typename Func>
+    struct QueuedFunctionCall : public QueuedEvent
+    {
+        template<typename T>
+        explicit QueuedFunctionCall(T&& f) : QueuedEvent(&impl), function(std::forward<T>(f)) {}
+
+        Func function;
+
+    private:
+        static void impl(QueuedEvent* this_, bool exec) {
+            auto _this = static_cast<QueuedFunctionCall*>(this_);
+            if (exec) {
+                _this->function();
+            }
+            delete _this;
+        }
+    };
+
+    // DeferredSignal 在 EventLoop 待发送列表中的节点，嵌在信号中，挂上和摘下都不分配内存。
+    // 双向循环链表，EventLoop 中的哨兵节点 flush 为空。
+    struct DeferredNode
+    {
+        // 以保存的参数发送一次，没有待发送的参数时返回 false。
+        typedef bool (*FlushFn)(DeferredNode* this_);
+
+        explicit DeferredNode(FlushFn fn) noexcept : flush(fn) {}
+        DeferredNode(const DeferredNode&) = delete;
+        DeferredNode& operator=(const DeferredNode&) = delete;
+
+        DeferredNode* prev = this;
+        DeferredNode* next = this;
+        EventLoop* loop = nullptr;
+        FlushFn const flush;
+    };
+
+    inline thread_local EventLoop* g_currentLoop = nullptr;
+}
+
+/// <summary>
+/// 线程的事件循环。每个线程第一次调用 EventLoop::current() 时创建，
+/// 其他线程通过无锁队列投递 Queued 连接的槽调用，由本线程的 exec() 或 processEvents() 执行。
+/// 由所在线程及属于它的 Object 共同引用计数，线程退出后仍未执行的事件在循环销毁时丢弃。
+/// </summary>
+class EventLoop {
+public:
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    static EventLoop* current();
+
+    bool isCurrentThread() const noexcept {
+        return objectImpl::g_currentLoop == this;
+    }
+
+    template<typename Func>
+    void post(Func&& func) {
+        postEvent(new objectImpl::QueuedFunctionCall<std::decay_t<Func>>(std::forward<Func>(func)));
+    }
+
+    void postEvent(objectImpl::QueuedEvent* ev) {
+        m_queue.push(ev);
+        if (m_sleeping.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_one();
+        }
+    }
+
+    /// 执行当前所有待处理事件，然后 flushDeferred()，不阻塞。返回执行的事件和发送的 DeferredSignal 个数。
+    size_t processEvents() {
+        assert(isCurrentThread());
+        size_t count = 0;
+        while (!m_queue.empty()) {
+            auto ev = m_queue.pop();
+            if (!ev) {
+                std::this_thread::yield();
+                continue;
+            }
+            ev->run();
+            ++count;
+        }
+        return count + flushDeferred();
+    }
+
+    /// 发送所有待发送的 DeferredSignal，每个信号以最后一次发送的参数发送一次。返回发送的信号个数。
+    /// 槽中再次发送的信号留到下一次 flushDeferred()。
+    size_t flushDeferred() {
+        assert(isCurrentThread());
+        size_t count = 0;
+        for (size_t n = m_deferredCount.load(std::memory_order_acquire); n > 0; --n) {
+            objectImpl::DeferredNode* node;
+            {
+                std::lock_guard<objectImpl::SpinLock> lock(m_deferredLock);
+                node = m_deferred.next;
+                if (node == &m_deferred) {
+                    break;
+                }
+                unlinkDeferred(node);
+            }
+            count += node->flush(node);
+        }
+        return count;
+    }
+
+    /// 把 DeferredSignal 加入待发送列表，已在列表中时不变。可以在任意线程调用。
+    void postDeferred(objectImpl::DeferredNode* node) {
+        {
+            std::lock_guard<objectImpl::SpinLock> lock(m_deferredLock);
+            if (node->next != node) {
+                return;
+            }
+            node->loop = this;
+            node->prev = m_deferred.prev;
+            node->next = &m_deferred;
+            m_deferred.prev->next = node;
+            m_deferred.prev = node;
+            m_deferredCount.fetch_add(1);
+        }
+        if (m_sleeping.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_one();
+        }
+    }
+
+    /// 从待发送列表中移除，不在列表中时不变。
+    void cancelDeferred(objectImpl::DeferredNode* node) noexcept {
+        std::lock_guard<objectImpl::SpinLock> lock(m_deferredLock);
+        if (node->next != node) {
+            unlinkDeferred(node);
+        }
+    }
+
+    /// 处理事件直到 quit() 被调用。
+    void exec() {
+        assert(isCurrentThread());
+        for (;;) {
+            processEvents();
+            if (m_quit.load()) {
+                break;
+            }
+
+            m_sleeping.store(true);
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cond.wait(lock, [this] { return !m_queue.empty() || m_deferredCount.load() || m_quit.load(); });
+            }
+            m_sleeping.store(false, std::memory_order_relaxed);
+        }
+        m_quit.store(false);
+    }
+
+    void quit() {
+        m_quit.store(true);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cond.notify_one();
+    }
+
+    void ref() noexcept {
+        m_ref.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void deref() noexcept {
+        if (m_ref.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+private:
+    EventLoop() = default;
+
+    ~EventLoop() {
+        while (!m_queue.empty()) {
+            if (auto ev = m_queue.pop()) {
+                ev->discard();
+            }
+        }
+        while (m_deferred.next != &m_deferred) {
+            unlinkDeferred(m_deferred.next);
+        }
+    }
+
+    void unlinkDeferred(objectImpl::DeferredNode* node) noexcept {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = node;
+        node->loop = nullptr;
+        m_deferredCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    objectImpl::MpscQueue m_queue;
+    objectImpl::SpinLock m_deferredLock;
+    objectImpl::DeferredNode m_deferred{ nullptr };
+    std::atomic<size_t> m_deferredCount = 0;
+    std::atomic<int> m_ref = 1;
+    std::atomic<bool> m_sleeping = false;
+    std::atomic<bool> m_quit = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+namespace objectImpl
+{
+    struct ThreadLoopHolder {
+        EventLoop* loop = nullptr;
+        ~ThreadLoopHolder() {
+            if (loop) {
+                g_currentLoop = nullptr;
+                loop->deref();
+            }
+        }
+    };
+    inline thread_local ThreadLoopHolder g_threadLoopHolder;
+}
+
+inline EventLoop* EventLoop::current() {
+    if (!objectImpl::g_currentLoop) {
+        objectImpl::g_threadLoopHolder.loop = new EventLoop();
+        objectImpl::g_currentLoop = objectImpl::g_threadLoopHolder.loop;
+    }
+    return objectImpl::g_currentLoop;
+}
+
+/// <summary>
+/// 运行 EventLoop 的线程。析构时退出循环并等待线程结束。
+/// </summary>
+class EventLoopThread {
+public:
+    EventLoopThread() {
+        std::mutex mutex;
+        std::condition_variable cond;
+        m_thread = std::thread([&] {
+            EventLoop* loop = EventLoop::current();
+            loop->ref();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                m_loop = loop;
+                cond.notify_one();
+            }
+            loop->exec();
+        });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return m_loop != nullptr; });
+    }
+
+    EventLoopThread(const EventLoopThread&) = delete;
+    EventLoopThread& operator=(const EventLoopThread&) = delete;
+
+    ~EventLoopThread() {
+        m_loop->quit();
+        m_thread.join();
+        m_loop->deref();
+    }
+
+    EventLoop* loop() const noexcept {
+        return m_loop;
+    }
+
+private:
+    EventLoop* m_loop = nullptr;
+    std::thread m_thread;
+};
+
+namespace objectImpl
+{
+    // 线程池中的任务。run 返回后线程池不再访问任务对象。
+    struct PoolTask {
+        void (*run)(PoolTask* this_) = nullptr;
+    };
+}
+
+/// <summary>
+/// 工作窃取线程池，执行 ConnecttionType::Parallel 连接的槽。
+/// 每个工作线程有自己的任务队列，从队尾取出自己提交的任务，队列为空时从其他线程的队头窃取。
+/// 等待任务完成的线程用 runOne() 一起执行任务，嵌套的并行发送不会因为所有线程都在等待而死锁。
+/// </summary>
+class ThreadPool {
+public:
+    /// threads 为 0 时使用硬件线程数减一，发送线程等待时也会执行任务。
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) {
+            unsigned hw = std::thread::hardware_concurrency();
+            threads = hw > 1 ? hw - 1 : 1;
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            m_workers.emplace_back(new Worker);
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this, i] { workerMain(i); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop.store(true);
+        }
+        m_cond.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /// Parallel 连接使用的线程池，第一次使用时创建。
+    static ThreadPool& global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const noexcept {
+        return m_workers.size();
+    }
+
+    /// 工作线程提交到自己的队列，其他线程轮流提交到各个工作线程的队列。
+    void submit(objectImpl::PoolTask* task) {
+        size_t index = s_pool == this ? s_index : m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+        Worker& worker = *m_workers[index];
+        {
+            std::lock_guard<objectImpl::SpinLock> lock(worker.lock);
+            worker.tasks.push_back(task);
+        }
+        m_queued.fetch_add(1);
+        if (m_sleeping.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_one();
+        }
+    }
+
+    /// 取出并执行一个任务，没有任务时返回 false。
+    bool runOne() {
+        auto task = take();
+        if (!task) {
+            return false;
+        }
+        task->run(task);
+        return true;
+    }
+
+private:
+    struct alignas(64) Worker {
+        objectImpl::SpinLock lock;
+        std::deque<objectImpl::PoolTask*> tasks;
+    };
+
+    objectImpl::PoolTask* take() {
+        if (m_queued.load(std::memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+
+        size_t self = 0;
+        if (s_pool == this) {
+            self = s_index;
+            Worker& worker = *m_workers[self];
+            std::lock_guard<objectImpl::SpinLock> lock(worker.lock);
+            if (!worker.tasks.empty()) {
+                auto task = worker.tasks.back();
+                worker.tasks.pop_back();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+
+        for (size_t i = 0, n = m_workers.size(); i < n; ++i) {
+            Worker& worker = *m_workers[(self + i) % n];
+            std::lock_guard<objectImpl::SpinLock> lock(worker.lock);
+            if (!worker.tasks.empty()) {
+                auto task = worker.tasks.front();
+                worker.tasks.pop_front();
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void workerMain(size_t index) {
+        s_pool = this;
+        s_index = index;
+        for (;;) {
+            if (runOne()) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping.fetch_add(1);
+            m_cond.wait(lock, [this] { return m_queued.load() > 0 || m_stop.load(); });
+            m_sleeping.fetch_sub(1);
+            if (m_stop.load() && m_queued.load() == 0) {
+                break;
+            }
+        }
+    }
+
+    inline static thread_local ThreadPool* s_pool = nullptr;
+    inline static thread_local size_t s_index = 0;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued = 0;
+    std::atomic<size_t> m_next = 0;
+    std::atomic<int> m_sleeping = 0;
+    std::atomic<bool> m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+/// <summary>
+/// connect 返回的连接句柄，持有连接的引用。可以在 O(1) 时间内断开、阻塞或查询连接。
+/// 句柄析构不会断开连接，需要自动断开时使用 ScopedConnection。
+/// </summary>
+class ConnectionHandle {
+public:
+    ConnectionHandle() noexcept = default;
+
+    explicit ConnectionHandle(objectImpl::Connection* conn) noexcept : m_conn(conn) {
+        if (m_conn) {
+            m_conn->addRef();
+        }
+    }
+
+    ConnectionHandle(const ConnectionHandle& other) noexcept : ConnectionHandle(other.m_conn) {}
+
+    ConnectionHandle(ConnectionHandle&& other) noexcept : m_conn(other.m_conn) {
+        other.m_conn = nullptr;
+    }
+
+    ConnectionHandle& operator=(ConnectionHandle other) noexcept {
+        std::swap(m_conn, other.m_conn);
+        return *this;
+    }
+
+    ~ConnectionHandle() {
+        if (m_conn) {
+            m_conn->deref();
+        }
+    }
+
+    /// 断开连接。返回连接之前是否处于连接状态。
+    bool disconnect() noexcept {
+        return m_conn && m_conn->disconnect();
+    }
+
+    bool isConnected() const noexcept {
+        return m_conn && m_conn->connected.load(std::memory_order_relaxed);
+    }
+
+    bool blocked() const noexcept {
+        return m_conn && m_conn->blocked.load(std::memory_order_relaxed);
+    }
+
+    /// 阻塞的连接在发送信号时被跳过。返回之前是否阻塞。
+    bool setBlocked(bool block) noexcept {
+        return m_conn && m_conn->setBlocked(block);
+    }
+
+    operator bool() const noexcept {
+        return isConnected();
+    }
+
+private:
+    objectImpl::Connection* m_conn = nullptr;
+};
+
+/// <summary>
+/// 析构时断开连接的 ConnectionHandle。
+/// </summary>
+class ScopedConnection {
+public:
+    ScopedConnection() noexcept = default;
+    ScopedConnection(ConnectionHandle handle) noexcept : m_handle(std::move(handle)) {}
+    ScopedConnection(ScopedConnection&&) noexcept = default;
+    ScopedConnection(const ScopedConnection&) = delete;
+    ScopedConnection& operator=(const ScopedConnection&) = delete;
+
+    ScopedConnection& operator=(ScopedConnection&& other) noexcept {
+        if (this != &other) {
+            m_handle.disconnect();
+            m_handle = std::move(other.m_handle);
+        }
+        return *this;
+    }
+
+    ~ScopedConnection() {
+        m_handle.disconnect();
+    }
+
+    /// 放弃所有权，返回的句柄析构时不会断开连接。
+    ConnectionHandle release() noexcept {
+        return std::move(m_handle);
+    }
+
+    const ConnectionHandle& handle() const noexcept {
+        return m_handle;
+    }
+
+    bool disconnect() noexcept {
+        return m_handle.disconnect();
+    }
+
+    bool isConnected() const noexcept {
+        return m_handle.isConnected();
+    }
+
+    bool blocked() const noexcept {
+        return m_handle.blocked();
+    }
+
+    bool setBlocked(bool block) noexcept {
+        return m_handle.setBlocked(block);
+    }
+
+    operator bool() const noexcept {
+        return m_handle.isConnected();
+    }
+
+private:
+    ConnectionHandle m_handle;
+};
+
+namespace objectImpl
+{
+    // 基于 epoch 的延迟回收。发送信号的线程进入临界区时公布当前 epoch，
+    // 被替换的连接数组和被移除的连接要等所有可能还在读取它们的线程离开后才释放。
+    class EpochDomain
+    {
+    public:
+        struct Record {
+            std::atomic<uint64_t> epoch = 0;
+            std::atomic<bool> inUse = true;
+            Record* next = nullptr;
+            size_t nesting = 0;
+            // 最外层的 enterLocal() 只宽松地写入了纪元，其中嵌套的 enter() 需要重新发布。
+            bool local = false;
+        };
+
+        constexpr EpochDomain() noexcept = default;
+
+        static Record* record() noexcept;
+
+        void enter(Record* r) noexcept {
+            if (r->nesting++ == 0) {
+                r->epoch.store(m_epoch.load());
+                r->local = false;
+            }
+            else if (r->local) {
+                // 外层单线程信号的宽松写入对其他线程的回收没有顺序保证，以全屏障重新写入同一个纪元。
+                // 不能换成当前纪元，外层的发送还在读取可能在此之后回收的数组。
+                r->epoch.store(r->epoch.load(std::memory_order_relaxed));
+                r->local = false;
+            }
+        }
+
+        void exit(Record* r) noexcept {
+            if (--r->nesting == 0) {
+                r->epoch.store(0, std::memory_order_release);
+            }
+        }
+
+        // 单线程信号的发送。只有本线程会移除它的连接，移除时的 retire 在本线程中排在这次写之后，
+        // 其他线程经过 m_lock 看到这次写，所以不需要 enter() 中的全屏障。
+        void enterLocal(Record* r) noexcept {
+            if (r->nesting++ == 0) {
+                r->epoch.store(m_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                r->local = true;
+            }
+        }
+
+        // 其中嵌套过 enter() 时，那次发送的读取要排在清零之前。
+        void exitLocal(Record* r) noexcept {
+            if (--r->nesting == 0) {
+                r->epoch.store(0, r->local ? std::memory_order_relaxed : std::memory_order_release);
+            }
+        }
+
+        // 纪元在锁内取得，链表按纪元从小到大排列。等待释放的对象达到阈值时才回收；
+        // 有线程长时间停在发送中、回收不掉时阈值加倍，每次断开的代价仍是均摊常数。
+        void retire(void* ptr, void (*deleter)(void*)) {
+            auto node = new Retired{ ptr, deleter, 0, nullptr };
+            bool full;
+            {
+                std::lock_guard<SpinLock> lock(m_lock);
+                node->epoch = m_epoch.fetch_add(1);
+                if (m_tail) {
+                    m_tail->next = node;
+                }
+                else {
+                    m_head = node;
+                }
+                m_tail = node;
+                full = ++m_pending >= m_threshold;
+            }
+            if (full) {
+                reclaim();
+            }
+        }
+
+        // 从链表头释放纪元早于所有正在发送的线程的对象，遇到第一个不能释放的就停止。返回是否还有等待释放的对象。
+        bool reclaim() {
+            Retired* ready = nullptr;
+            bool pending = false;
+            {
+                std::lock_guard<SpinLock> lock(m_lock);
+                uint64_t minEpoch = UINT64_MAX;
+                for (auto r = m_records.load(); r; r = r->next) {
+                    uint64_t e = r->epoch.load();
+                    if (e != 0 && e < minEpoch) {
+                        minEpoch = e;
+                    }
+                }
+
+                if (m_head && m_head->epoch < minEpoch) {
+                    ready = m_head;
+                    Retired* last = m_head;
+                    --m_pending;
+                    while (last->next && last->next->epoch < minEpoch) {
+                        last = last->next;
+                        --m_pending;
+                    }
+                    m_head = last->next;
+                    last->next = nullptr;
+                    if (!m_head) {
+                        m_tail = nullptr;
+                    }
+                }
+                m_threshold = (std::max)(MinThreshold, m_pending * 2);
+                pending = m_head != nullptr;
+            }
+
+            while (ready) {
+                auto item = ready;
+                ready = ready->next;
+                item->deleter(item->ptr);
+                delete item;
+            }
+            return pending;
+        }
+
+        void synchronize();
+
+        Record* acquireRecord() {
+            for (auto r = m_records.load(std::memory_order_acquire); r; r = r->next) {
+                bool expect = false;
+                if (!r->inUse.load(std::memory_order_relaxed) && r->inUse.compare_exchange_strong(expect, true)) {
+                    return r;
+                }
+            }
+
+            auto r = new Record;
+            r->next = m_records.load(std::memory_order_relaxed);
+            while (!m_records.compare_exchange_weak(r->next, r)) {
+            }
+            return r;
+        }
+
+    private:
+        // 每次断开连接都会产生一个节点，从固定大小的池中分配，不在连接、断开的路径上调用 malloc。
+        struct Retired {
+            void* ptr;
+            void (*deleter)(void*);
+            uint64_t epoch;
+            Retired* next;
+
+            static void* operator new(size_t size) {
+                assert(size == sizeof(Retired));
+                static_cast<void>(size);
+                return FixedBlockPool<sizeof(Retired), alignof(Retired)>::instance().allocate();
+            }
+
+            static void operator delete(void* p) noexcept {
+                FixedBlockPool<sizeof(Retired), alignof(Retired)>::instance().deallocate(p);
+            }
+        };
+
+        std::atomic<uint64_t> m_epoch = 1;
+        std::atomic<Record*> m_records = nullptr;
+        static constexpr size_t MinThreshold = 32;
+
+        SpinLock m_lock;
+        Retired* m_head = nullptr;
+        Retired* m_tail = nullptr;
+        size_t m_pending = 0;
+        size_t m_threshold = MinThreshold;
+    };
+
+    inline EpochDomain g_epochDomain;
+    inline thread_local std::pmr::memory_resource* g_memoryResource = nullptr;
+    inline OBJECT_THREAD_LOCAL EpochDomain::Record* g_epochRecord = nullptr;
+
+    struct EpochRecordHolder {
+        ~EpochRecordHolder() {
+            if (g_epochRecord) {
+                g_epochRecord->epoch.store(0);
+                g_epochRecord->nesting = 0;
+                g_epochRecord->inUse.store(false, std::memory_order_release);
+                g_epochRecord = nullptr;
+            }
+        }
+    };
+
+    inline EpochDomain::Record* EpochDomain::record() noexcept {
+        if (!g_epochRecord) {
+            static OBJECT_THREAD_LOCAL EpochRecordHolder holder;
+            g_epochRecord = g_epochDomain.acquireRecord();
+        }
+        return g_epochRecord;
+    }
+
+    inline void EpochDomain::synchronize() {
+        assert((!g_epochRecord || g_epochRecord->nesting == 0) && "synchronizeSignals() called while emitting.");
+        while (reclaim()) {
+            std::this_thread::yield();
+        }
+    }
+
+    struct EpochGuard {
+        EpochGuard() noexcept : record(EpochDomain::record()) {
+            g_epochDomain.enter(record);
+        }
+
+        ~EpochGuard() noexcept {
+            g_epochDomain.exit(record);
+        }
+
+        EpochDomain::Record* const record;
+    };
+
+    // 发送期间标记当前线程正在读取连接数组，按线程模型选择同步方式。
+    template<typename Policy>
+    struct EmitGuard : EpochGuard {
+    };
+
+    template<>
+    struct EmitGuard<threading::SingleThreaded> {
+        EmitGuard() noexcept : record(EpochDomain::record()) {
+            g_epochDomain.enterLocal(record);
+        }
+
+        ~EmitGuard() noexcept {
+            g_epochDomain.exitLocal(record);
+        }
+
+        EpochDomain::Record* const record;
+    };
+
+    // 发送时顺序访问的连接数据。槽对象可以复制时在这里存放一份副本，
+    // 直接调用的连接在发送时不需要访问 Connection。
+    struct EmitEntry
+    {
+        SlotObjectBase slot;
+        Object* recver = nullptr;
+        ConnecttionType type = ConnecttionType::Auto;
+        int priority = 0;
+    };
+
+    // 信号的连接数组。发送线程不加锁遍历，写线程持有信号的锁：
+    // 追加写在 size 之后再发布 size，移除时原地置空，扩容或压缩时复制一份新数组发布。
+    // 连接按 priority 从高到低排列，相同优先级按连接顺序；需要插入到中间时复制一份新数组。
+    // 按列存放：entries 是发送用的数据，states 是每个连接的状态（存活、阻塞），items 是对应的 Connection。
+    struct ConnectionList
+    {
+        static ConnectionList* create(size_t capacity, std::pmr::memory_resource* resource) {
+            void* mem = resource->allocate(bytes(capacity), alignof(ConnectionList));
+            auto list = new (mem) ConnectionList;
+            list->capacity = capacity;
+            list->resource = resource;
+            list->entries = reinterpret_cast<EmitEntry*>(list + 1);
+            list->items = reinterpret_cast<std::atomic<Connection*>*>(list->entries + capacity);
+            list->states = reinterpret_cast<std::atomic<uint8_t>*>(list->items + capacity);
+            for (size_t i = 0; i < capacity; ++i) {
+                new (&list->entries[i]) EmitEntry;
+                new (&list->items[i]) std::atomic<Connection*>(nullptr);
+                new (&list->states[i]) std::atomic<uint8_t>(0);
+            }
+            return list;
+        }
+
+        // entries 中的槽对象都是平凡复制的副本，不需要析构。
+        static void destroy(void* p) {
+            auto list = static_cast<ConnectionList*>(p);
+            list->destroyIndex();
+            list->resource->deallocate(list, bytes(list->capacity), alignof(ConnectionList));
+        }
+
+        static constexpr size_t bytes(size_t capacity) noexcept {
+            return sizeof(ConnectionList) + (sizeof(EmitEntry) + sizeof(std::atomic<Connection*>) + sizeof(std::atomic<uint8_t>)) * capacity;
+        }
+
+        // 在 index 处放入连接，slot 是复制来源（新连接的槽对象或旧数组中的副本）。
+        void assign(size_t index, Connection* conn, ConnecttionType type, int priority, SlotObjectBase& slot) {
+            EmitEntry& entry = entries[index];
+            entry.recver = conn->recver;
+            entry.type = type;
+            entry.priority = priority;
+            slot.cloneTo(entry.slot);
+            items[index].store(conn, std::memory_order_relaxed);
+            conn->attach(&states[index]);
+        }
+
+        static size_t indexKey(const Object* obj, size_t hash) noexcept {
+            return hash ^ (reinterpret_cast<size_t>(obj) * 0x9e3779b97f4a7c15ull);
+        }
+
+        void createIndex() {
+            void* mem = resource->allocate(sizeof(Index), alignof(Index));
+            index = new (mem) Index(resource);
+            for (size_t i = 0, n = size.load(std::memory_order_relaxed); i < n; ++i) {
+                auto conn = items[i].load(std::memory_order_relaxed);
+                if (conn && conn->connected.load(std::memory_order_relaxed)) {
+                    addToIndex(conn);
+                }
+            }
+        }
+
+        void destroyIndex() noexcept {
+            if (index) {
+                index->~Index();
+                resource->deallocate(index, sizeof(Index), alignof(Index));
+                index = nullptr;
+            }
+        }
+
+        void addToIndex(Connection* conn) {
+            if (size_t hash = conn->slot.hash()) {
+                index->emplace(indexKey(conn->recver, hash), conn);
+            }
+        }
+
+        void removeFromIndex(Connection* conn) {
+            if (size_t hash = conn->slot.hash()) {
+                auto range = index->equal_range(indexKey(conn->recver, hash));
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (it->second == conn) {
+                        index->erase(it);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // 以 (接收者, 槽哈希) 为键的索引，连接数不少于 IndexThreshold 并且需要按槽查找时才创建，
+        // 只在持有信号的锁时访问，发送线程不使用。
+        using Index = std::pmr::unordered_multimap<size_t, Connection*>;
+        static constexpr size_t IndexThreshold = 16;
+
+        std::atomic<size_t> size = 0;
+        size_t capacity = 0;
+        size_t removed = 0;     // 持有锁时移除的连接数，不包括通过句柄或接收者析构断开的
+        std::pmr::memory_resource* resource = nullptr;
+        Index* index = nullptr;
+        EmitEntry* entries = nullptr;
+        std::atomic<Connection*>* items = nullptr;
+        std::atomic<uint8_t>* states = nullptr;
+    };
+
+    // 只占一个指针的指针数组，空时不分配内存。内存由调用者传入的 memory_resource 分配和释放。
+    // 删除的位置成为墓碑并串成空闲链表，插入时优先复用，元素的下标在 shrink 之前保持不变。
+    // 插入只在没有空闲位置时扩容；存活元素过少时由删除方调用 shrink 压缩，代价由之前的删除分摊。
+    template<typename T>
+    class PointerArray
+    {
+        static_assert(std::is_pointer_v<T>);
+
+        struct Header {
+            size_t size;        // 用过的位置数，包括墓碑
+            size_t capacity;
+            size_t live;
+            size_t freeHead;
+        };
+
+        static constexpr size_t None = SIZE_MAX;
+        static constexpr size_t MinCapacity = 4;
+
+    public:
+        PointerArray() noexcept = default;
+        PointerArray(const PointerArray&) = delete;
+        PointerArray& operator=(const PointerArray&) = delete;
+
+        ~PointerArray() {
+            assert(!m_header && "PointerArray must be released with clear(resource).");
+        }
+
+        // 存活元素数。
+        size_t size() const noexcept { return m_header ? m_header->live : 0; }
+        // 可以用 at() 访问的位置数，包括墓碑。
+        size_t extent() const noexcept { return m_header ? m_header->size : 0; }
+        size_t capacity() const noexcept { return m_header ? m_header->capacity : 0; }
+        bool empty() const noexcept { return size() == 0; }
+
+        // 没有可以复用的位置，下一次插入需要扩容。
+        bool full() const noexcept {
+            return !m_header || (m_header->freeHead == None && m_header->size == m_header->capacity);
+        }
+
+        // 墓碑返回 nullptr。
+        T at(size_t index) const noexcept {
+            uintptr_t value = items()[index];
+            return (value & 1) ? nullptr : reinterpret_cast<T>(value);
+        }
+
+        // 依次访问存活元素。f 中可以删除元素，但不能 shrink。
+        template<typename F>
+        void forEach(F&& f) const {
+            for (size_t i = 0; i < extent(); ++i) {
+                if (T value = at(i)) {
+                    f(value);
+                }
+            }
+        }
+
+        // 返回元素的下标。
+        size_t insert(T value, std::pmr::memory_resource* resource) {
+            assert(value && !(reinterpret_cast<uintptr_t>(value) & 1));
+            size_t index;
+            if (m_header && m_header->freeHead != None) {
+                index = m_header->freeHead;
+                m_header->freeHead = (items()[index] >> 1) - 1;
+            }
+            else {
+                if (full()) {
+                    reallocate((std::max)(MinCapacity, capacity() * 2), resource);
+                }
+                index = m_header->size++;
+            }
+            items()[index] = reinterpret_cast<uintptr_t>(value);
+            ++m_header->live;
+            return index;
+        }
+
+        void erase(size_t index) noexcept {
+            assert(at(index));
+            items()[index] = ((m_header->freeHead + 1) << 1) | 1;
+            m_header->freeHead = index;
+            --m_header->live;
+        }
+
+        void reserve(size_t capacity, std::pmr::memory_resource* resource) {
+            if (capacity > this->capacity()) {
+                reallocate(capacity, resource);
+            }
+        }
+
+        // 存活元素不到容量的 1/4 时压缩到新数组，onMove(value, index) 通知元素的新下标。
+        template<typename OnMove>
+        bool shrink(std::pmr::memory_resource* resource, OnMove&& onMove) {
+            if (!m_header || m_header->capacity <= MinCapacity || m_header->live * 4 > m_header->capacity) {
+                return false;
+            }
+
+            if (m_header->live == 0) {
+                clear(resource);
+                return true;
+            }
+
+            size_t capacity = (std::max)(MinCapacity, m_header->live * 2);
+            auto header = static_cast<Header*>(resource->allocate(bytes(capacity), alignof(Header)));
+            *header = Header{ 0, capacity, m_header->live, None };
+            auto dst = reinterpret_cast<uintptr_t*>(header + 1);
+            for (size_t i = 0; i < m_header->size; ++i) {
+                if (T value = at(i)) {
+                    dst[header->size] = reinterpret_cast<uintptr_t>(value);
+                    onMove(value, header->size++);
+                }
+            }
+            resource->deallocate(m_header, bytes(m_header->capacity), alignof(Header));
+            m_header = header;
+            return true;
+        }
+
+        void clear(std::pmr::memory_resource* resource) noexcept {
+            if (m_header) {
+                resource->deallocate(m_header, bytes(m_header->capacity), alignof(Header));
+                m_header = nullptr;
+            }
+        }
+
+        void swap(PointerArray& other) noexcept {
+            std::swap(m_header, other.m_header);
+        }
+
+    private:
+        static constexpr size_t bytes(size_t capacity) noexcept {
+            return sizeof(Header) + sizeof(uintptr_t) * capacity;
+        }
+
+        uintptr_t* items() const noexcept {
+            return reinterpret_cast<uintptr_t*>(m_header + 1);
+        }
+
+        void reallocate(size_t capacity, std::pmr::memory_resource* resource) {
+            auto header = static_cast<Header*>(resource->allocate(bytes(capacity), alignof(Header)));
+            if (m_header) {
+                *header = *m_header;
+                std::memcpy(header + 1, items(), sizeof(uintptr_t) * m_header->size);
+                resource->deallocate(m_header, bytes(m_header->capacity), alignof(Header));
+            }
+            else {
+                *header = Header{ 0, 0, 0, None };
+            }
+            header->capacity = capacity;
+            m_header = header;
+        }
+
+        Header* m_header = nullptr;
+    };
+
+    struct Utils
+    {
+        inline static bool addConnection(Object* obj, Connection* conn);
+        inline static EventLoop* threadOf(const Object* obj) noexcept;
+        inline static std::pmr::memory_resource* memoryResource(const Object* obj) noexcept;
+
+        static bool isDirect(ConnecttionType type, const Object* recver) noexcept {
+            return type == ConnecttionType::Direct
+                || (type == ConnecttionType::Auto && (!recver || threadOf(recver) == g_currentLoop));
+        }
+
+        // move 为 true 时这是本次发送的最后一个槽，可以移动按值传递的参数。
+        // 槽在返回前被调用时返回 true，ret 不为空时槽的返回值构造在 ret 中。
+        // 带返回值的信号按顺序调用槽，Parallel 连接同 Direct。
+        static bool activate(Connection* conn, ConnecttionType type, void** args, bool move, void* ret) {
+            if (type == ConnecttionType::Auto) {
+                if (!conn->recver || threadOf(conn->recver) == g_currentLoop) {
+                    conn->slot.call(conn->recver, args, move, ret);
+                    return true;
+                }
+                type = ConnecttionType::Queued;
+            }
+
+            if (type == ConnecttionType::Direct || type == ConnecttionType::Parallel) {
+                conn->slot.call(conn->recver, args, move, ret);
+                return true;
+            }
+
+            EventLoop* loop = threadOf(conn->recver ? conn->recver : conn->sender);
+            if (type == ConnecttionType::Queued) {
+                QueuedSlotCallBase* ev = conn->slot.queue(args, move);
+                assert(ev && "Queued connection requires copy constructible arguments.");
+                if (ev) {
+                    conn->addRef();
+                    ev->conn = conn;
+                    loop->postEvent(ev);
+                }
+                return false;
+            }
+
+            assert(loop != g_currentLoop && "BlockingQueued connection in the same thread would deadlock.");
+            if (loop == g_currentLoop) {
+                conn->slot.call(conn->recver, args, false, ret);
+                return true;
+            }
+            BlockingSlotCall ev(conn, args, ret);
+            conn->addRef();
+            loop->postEvent(&ev);
+            ev.wait();
+            conn->deref();
+            return ev.called;
+        }
+
+        static size_t addChild(PointerArray<Object*>& chidren, Object* chid, std::pmr::memory_resource* resource) {
+            return chidren.insert(chid, resource);
+        }
+
+        // 没有空闲位置时先回收已断开的连接。回收后空闲位置仍不到 1/4 时直接扩容，
+        // 这样两次回收之间至少有 capacity/4 次插入，回收的代价被分摊。
+        static void addConnection(PointerArray<Connection*>& conns, Connection* conn, std::pmr::memory_resource* resource) {
+            if (conns.full() && !conns.empty()) {
+                for (size_t i = 0, n = conns.extent(); i < n; ++i) {
+                    auto item = conns.at(i);
+                    if (item && !item->connected.load(std::memory_order_relaxed)) {
+                        item->release();
+                        conns.erase(i);
+                    }
+                }
+
+                if (!conns.shrink(resource, [](Connection*, size_t) {}) && conns.size() * 4 > conns.capacity() * 3) {
+                    conns.reserve(conns.capacity() * 2, resource);
+                }
+            }
+
+            conns.insert(conn, resource);
+        }
+    };
+
+    // 一次发送中 Parallel 连接的槽调用，提交到 ThreadPool::global()。
+    // join() 等待已提交的调用完成，等待时发送线程也执行线程池中的任务，槽抛出的第一个异常在这里重新抛出。
+    // 放在发送的栈上，前 InlineCalls 个调用使用内部的数组，更多时才分配剩余的部分。
+    class ParallelEmit
+    {
+    public:
+        static constexpr size_t InlineCalls = 8;
+
+        ParallelEmit(Object* sender, void** args, size_t capacity) noexcept
+            : m_sender(sender), m_args(args), m_capacity(capacity) {
+        }
+
+        ParallelEmit(const ParallelEmit&) = delete;
+        ParallelEmit& operator=(const ParallelEmit&) = delete;
+
+        ~ParallelEmit() {
+            wait();
+        }
+
+        void submit(SlotObjectBase* slot, Object* recver) {
+            if (m_count == InlineCalls) {
+                m_overflow.reset(new Call[m_capacity - InlineCalls]);
+            }
+            Call& call = m_count < InlineCalls ? m_inline[m_count] : m_overflow[m_count - InlineCalls];
+            ++m_count;
+            call.run = &Call::invoke;
+            call.owner = this;
+            call.slot = slot;
+            call.recver = recver;
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            ThreadPool::global().submit(&call);
+        }
+
+        void join() {
+            wait();
+            if (m_failed.load(std::memory_order_relaxed)) {
+                m_failed.store(false, std::memory_order_relaxed);
+                std::rethrow_exception(std::move(m_error));
+            }
+        }
+
+    private:
+        struct Call : public PoolTask {
+            ParallelEmit* owner = nullptr;
+            SlotObjectBase* slot = nullptr;
+            Object* recver = nullptr;
+
+            static void invoke(PoolTask* task) {
+                auto call = static_cast<Call*>(task);
+                auto owner = call->owner;
+                try {
+                    SenderGuard sender(owner->m_sender);
+                    call->slot->call(call->recver, owner->m_args);
+                }
+                catch (...) {
+                    if (!owner->m_failed.exchange(true, std::memory_order_relaxed)) {
+                        owner->m_error = std::current_exception();
+                    }
+                }
+                owner->m_pending.fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+        void wait() noexcept {
+            if (!m_count) {
+                return;
+            }
+            while (m_pending.load(std::memory_order_acquire)) {
+                if (!ThreadPool::global().runOne()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        Object* const m_sender;
+        void** const m_args;
+        const size_t m_capacity;
+        size_t m_count = 0;
+        Call m_inline[InlineCalls];
+        std::unique_ptr<Call[]> m_overflow;
+        std::atomic<size_t> m_pending = 0;
+        std::atomic<bool> m_failed = false;
+        std::exception_ptr m_error;
+    };
+
+    // 发送时栈上的 ParallelEmit，遇到第一个 Parallel 连接时才构造。
+    // 不用 std::optional：GCC 会在构造时清零整个存储，每次发送都要多写几百字节。
+    class LazyParallelEmit
+    {
+    public:
+        LazyParallelEmit() noexcept = default;
+        LazyParallelEmit(const LazyParallelEmit&) = delete;
+        LazyParallelEmit& operator=(const LazyParallelEmit&) = delete;
+
+        ~LazyParallelEmit() {
+            if (m_emit) {
+                m_emit->~ParallelEmit();
+            }
+        }
+
+        void emplace(Object* sender, void** args, size_t capacity) noexcept {
+            m_emit = new (m_storage) ParallelEmit(sender, args, capacity);
+        }
+
+        explicit operator bool() const noexcept {
+            return m_emit != nullptr;
+        }
+
+        ParallelEmit* operator->() const noexcept {
+            return m_emit;
+        }
+
+    private:
+        ParallelEmit* m_emit = nullptr;
+        alignas(ParallelEmit) unsigned char m_storage[sizeof(ParallelEmit)];
+    };
+
+    // 带返回值的信号发送时收集槽的返回值。槽把返回值构造在 storage 中，
+    // collect 取走并销毁它，返回 false 时结果已经确定，不再调用后面的槽。
+    struct ResultCollector
+    {
+        void* storage;
+        bool (*collect)(ResultCollector* this_);
+    };
+
+    // co_await 信号的协程挂在 SignalData 上的等待者，存放在协程帧中，不单独分配。
+    // 发送时整条链表被取下，resume 复制参数后恢复协程；args 为空表示信号已析构。
+    struct SignalWaiter
+    {
+        typedef void (*ResumeFn)(SignalWaiter* this_, void** args);
+        explicit SignalWaiter(ResumeFn fn) noexcept : resume(fn) {}
+
+        ResumeFn const resume;
+        SignalWaiter* prev = nullptr;
+        SignalWaiter* next = nullptr;
+        // 在 SignalData 的链表中，持有锁时更新。
+        std::atomic<bool> linked = false;
+    };
+
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+    // 信号声明的位置，同一处声明的所有信号实例共用一份统计。
+    struct SignalSite
+    {
+        const char* name;
+        const char* file;
+        int line;
+    };
+
+    // 对数线性分桶的延迟直方图（HDR 风格）：小于 16 的值各占一个桶，之后每个 2 的幂分 16 个桶，相对误差不超过 1/16。
+    // 记录只有原子加，不加锁。
+    class LatencyHistogram
+    {
+    public:
+        static constexpr int SubBits = 4;
+        static constexpr uint64_t SubCount = uint64_t(1) << SubBits;
+        static constexpr int MaxShift = 40;
+        static constexpr size_t BucketCount = (MaxShift + 2) * SubCount;
+
+        void record(uint64_t value) noexcept {
+            m_buckets[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            m_sum.fetch_add(value, std::memory_order_relaxed);
+            updateMax(m_max, value);
+        }
+
+        uint64_t count() const noexcept {
+            return m_count.load(std::memory_order_relaxed);
+        }
+
+        uint64_t sum() const noexcept {
+            return m_sum.load(std::memory_order_relaxed);
+        }
+
+        uint64_t max() const noexcept {
+            return m_max.load(std::memory_order_relaxed);
+        }
+
+        uint64_t bucket(size_t index) const noexcept {
+            return m_buckets[index].load(std::memory_order_relaxed);
+        }
+
+        // 第 p (0~1) 分位所在桶的上界，不超过记录到的最大值。
+        uint64_t percentile(double p) const noexcept {
+            uint64_t total = count();
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = (std::max)(uint64_t(1), static_cast<uint64_t>(p * total + 0.5));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BucketCount; ++i) {
+                seen += bucket(i);
+                if (seen >= rank) {
+                    return (std::min)(lowerBound(i + 1) - 1, max());
+                }
+            }
+            return max();
+        }
+
+        void reset() noexcept {
+            for (auto& b : m_buckets) {
+                b.store(0, std::memory_order_relaxed);
+            }
+            m_count.store(0, std::memory_order_relaxed);
+            m_sum.store(0, std::memory_order_relaxed);
+            m_max.store(0, std::memory_order_relaxed);
+        }
+
+        static size_t indexOf(uint64_t value) noexcept {
+            if (value < SubCount) {
+                return static_cast<size_t>(value);
+            }
+            int shift = highestBit(value) - SubBits;
+            if (shift > MaxShift) {
+                return BucketCount - 1;
+            }
+            return static_cast<size_t>((shift + 1) * SubCount + ((value >> shift) - SubCount));
+        }
+
+        static uint64_t lowerBound(size_t index) noexcept {
+            if (index < SubCount) {
+                return index;
+            }
+            size_t shift = index / SubCount - 1;
+            return (index % SubCount + SubCount) << shift;
+        }
+
+        static void updateMax(std::atomic<uint64_t>& target, uint64_t value) noexcept {
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+            }
+        }
+
+    private:
+        static int highestBit(uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return 63 - __builtin_clzll(value);
+#else
+            int n = 0;
+            while (value >>= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+
+        std::atomic<uint64_t> m_buckets[BucketCount] = {};
+        std::atomic<uint64_t> m_count = 0;
+        std::atomic<uint64_t> m_sum = 0;
+        std::atomic<uint64_t> m_max = 0;
+    };
+
+    struct SignalStats
+    {
+        explicit SignalStats(const SignalSite& site) noexcept : site(site) {}
+
+        void reset() noexcept {
+            emits.store(0, std::memory_order_relaxed);
+            slotCalls.store(0, std::memory_order_relaxed);
+            maxFanout.store(0, std::memory_order_relaxed);
+            maxDepth.store(0, std::memory_order_relaxed);
+            latency.reset();
+        }
+
+        const SignalSite site;
+        std::atomic<uint64_t> emits = 0;
+        // 所有发送经过的活动连接数之和，除以 emits 为平均扇出。
+        std::atomic<uint64_t> slotCalls = 0;
+        std::atomic<uint64_t> maxFanout = 0;
+        std::atomic<uint64_t> maxDepth = 0;
+        // 每次同步调用槽的耗时（纳秒），Queued 连接为投递的耗时，Parallel 连接不计时。
+        LatencyHistogram latency;
+    };
+
+    // 当前线程中嵌套发送的层数，只统计带统计的信号。
+    inline static thread_local uint64_t g_emitDepth = 0;
+
+    // 一次发送的统计：发送次数、嵌套深度和扇出。
+    class EmitProbe
+    {
+    public:
+        explicit EmitProbe(SignalStats* stats) noexcept : m_stats(stats) {
+            if (m_stats) {
+                m_stats->emits.fetch_add(1, std::memory_order_relaxed);
+                LatencyHistogram::updateMax(m_stats->maxDepth, ++g_emitDepth);
+            }
+        }
+
+        EmitProbe(const EmitProbe&) = delete;
+        EmitProbe& operator=(const EmitProbe&) = delete;
+
+        ~EmitProbe() {
+            if (m_stats) {
+                --g_emitDepth;
+                m_stats->slotCalls.fetch_add(fanout, std::memory_order_relaxed);
+                LatencyHistogram::updateMax(m_stats->maxFanout, fanout);
+            }
+        }
+
+        uint64_t fanout = 0;
+
+    private:
+        SignalStats* const m_stats;
+    };
+
+    class SlotTimer
+    {
+    public:
+        explicit SlotTimer(SignalStats* stats) noexcept : m_stats(stats) {
+            if (m_stats) {
+                m_begin = std::chrono::steady_clock::now();
+            }
+        }
+
+        SlotTimer(const SlotTimer&) = delete;
+        SlotTimer& operator=(const SlotTimer&) = delete;
+
+        ~SlotTimer() {
+            if (m_stats) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_begin).count();
+                m_stats->latency.record(static_cast<uint64_t>(elapsed));
+            }
+        }
+
+    private:
+        SignalStats* const m_stats;
+        std::chrono::steady_clock::time_point m_begin;
+    };
+
+    // 按声明位置保存统计，统计对象一直保留到程序结束。
+    class StatsRegistry
+    {
+        using Key = std::tuple<std::string_view, int, std::string_view>;
+
+    public:
+        static StatsRegistry& instance() {
+            static StatsRegistry registry;
+            return registry;
+        }
+
+        SignalStats* find(const SignalSite& site) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& stats = m_stats[Key(site.file, site.line, site.name)];
+            if (!stats) {
+                stats.reset(new SignalStats(site));
+            }
+            return stats.get();
+        }
+
+        void reset() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& item : m_stats) {
+                item.second->reset();
+            }
+        }
+
+        std::string json() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::string out = "{\n  \"signals\": [";
+            const char* separator = "\n";
+            for (auto& item : m_stats) {
+                const SignalStats& s = *item.second;
+                const LatencyHistogram& h = s.latency;
+                char buf[512];
+                out += separator;
+                out += "    {\"name\": ";
+                appendString(out, s.site.name);
+                out += ", \"file\": ";
+                appendString(out, s.site.file);
+                std::snprintf(buf, sizeof(buf), ", \"line\": %d, \"emits\": %llu, \"slot_calls\": %llu, \"max_fanout\": %llu, \"max_depth\": %llu,\n"
+                    "     \"latency_ns\": {\"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu, \"buckets\": [",
+                    s.site.line, load(s.emits), load(s.slotCalls), load(s.maxFanout), load(s.maxDepth),
+                    static_cast<unsigned long long>(h.count()), h.count() ? static_cast<double>(h.sum()) / h.count() : 0.0,
+                    static_cast<unsigned long long>(h.percentile(0.5)), static_cast<unsigned long long>(h.percentile(0.9)),
+                    static_cast<unsigned long long>(h.percentile(0.99)), static_cast<unsigned long long>(h.percentile(0.999)),
+                    static_cast<unsigned long long>(h.max()));
+                out += buf;
+                // 只输出非空的桶：[下界, 次数]。
+                const char* comma = "";
+                for (size_t i = 0; i < LatencyHistogram::BucketCount; ++i) {
+                    if (uint64_t n = h.bucket(i)) {
+                        std::snprintf(buf, sizeof(buf), "%s[%llu, %llu]", comma,
+                            static_cast<unsigned long long>(LatencyHistogram::lowerBound(i)), static_cast<unsigned long long>(n));
+                        out += buf;
+                        comma = ", ";
+                    }
+                }
+                out += "]}}";
+                separator = ",\n";
+            }
+            out += "\n  ]\n}\n";
+            return out;
+        }
+
+    private:
+        static unsigned long long load(const std::atomic<uint64_t>& value) noexcept {
+            return static_cast<unsigned long long>(value.load(std::memory_order_relaxed));
+        }
+
+        static void appendString(std::string& out, const char* text) {
+            out += '"';
+            for (; *text; ++text) {
+                if (*text == '"' || *text == '\\') {
+                    out += '\\';
+                }
+                out += *text;
+            }
+            out += '"';
+        }
+
+        mutable std::mutex m_mutex;
+        std::map<Key, std::unique_ptr<SignalStats>> m_stats;
+    };
+#endif
+
+    // 信号第一次连接时分配的数据块。
+    struct SignalData
+    {
+        static SignalData* create(Object* parent, std::pmr::memory_resource* resource) {
+            void* mem = resource->allocate(sizeof(SignalData), alignof(SignalData));
+            return new (mem) SignalData(parent, resource);
+        }
+
+        static void destroy(void* p) {
+            auto d = static_cast<SignalData*>(p);
+            auto resource = d->resource;
+            d->~SignalData();
+            resource->deallocate(d, sizeof(SignalData), alignof(SignalData));
+        }
+
+        SignalData(Object* parent, std::pmr::memory_resource* resource) noexcept : parent(parent), resource(resource) {}
+
+        std::atomic<ConnectionList*> list = nullptr;
+        // 数组中未被移除的连接数，持有锁时更新。为 0 时发送直接返回。
+        std::atomic<size_t> live = 0;
+        // 等待下一次发送的协程，持有锁时更新。
+        std::atomic<SignalWaiter*> waiters = nullptr;
+        Object* const parent;
+        std::pmr::memory_resource* const resource;
+        SpinLock lock;
+    };
+
+#ifdef OBJECT_HAS_COROUTINES
+    template<typename... Args>
+    class SignalAwaiter;
+#endif
+
+    class SignalImplBase
+    {
+#ifdef OBJECT_HAS_COROUTINES
+        template<typename...> friend class SignalAwaiter;
+#endif
+    public:
+        SignalImplBase(const SignalImplBase&) = delete;
+        SignalImplBase& operator=(const SignalImplBase&) = delete;
+        explicit SignalImplBase(Object* parent) noexcept :m_data(reinterpret_cast<uintptr_t>(parent) | EmptyTag) {}
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+        // Signal() 宏传入声明位置，发送时记录到这个位置的统计中。
+        SignalImplBase(Object* parent, const SignalSite& site) : SignalImplBase(parent) {
+            m_stats = StatsRegistry::instance().find(site);
+        }
+#endif
+
+        ~SignalImplBase() {
+            if (auto d = data()) {
+                // 还在等待的协程以空结果恢复，不会再等到这个信号。
+                resumeWaiters(d, nullptr);
+                disconnect();
+                // 正在发送的线程在最后可能还会访问 d->lock，延迟到它们结束后释放。
+                g_epochDomain.retire(d, &SignalData::destroy);
+            }
+        }
+
+        bool disconnect() {
+            auto d = data();
+            if (!d) {
+                return false;
+            }
+
+            std::lock_guard<SpinLock> lock(d->lock);
+            auto list = d->list.load(std::memory_order_relaxed);
+            if (!list) {
+                return false;
+            }
+
+            d->list.store(nullptr);
+            d->live.store(0, std::memory_order_relaxed);
+            list->destroyIndex();
+            bool res = false;
+            for (size_t i = 0, n = list->size.load(std::memory_order_relaxed); i < n; ++i) {
+                if (auto conn = list->items[i].load(std::memory_order_relaxed)) {
+                    conn->disconnect();
+                    conn->attach(nullptr);
+                    res = true;
+                }
+            }
+            g_epochDomain.retire(list, &releaseList);
+            return res;
+        }
+
+        bool disconnect(const Object* obj) {
+            auto d = data();
+            if (!d) {
+                return false;
+            }
+
+            std::lock_guard<SpinLock> lock(d->lock);
+            auto list = d->list.load(std::memory_order_relaxed);
+            if (!list) {
+                return false;
+            }
+
+            bool res = false;
+            for (size_t i = 0, n = list->size.load(std::memory_order_relaxed); i < n; ++i) {
+                auto conn = list->items[i].load(std::memory_order_relaxed);
+                if (conn && conn->recver == obj) {
+                    removeAt(list, i);
+                    res = true;
+                }
+            }
+            compactIfSparse(d, list);
+            return res;
+        }
+
+        /// 是否有连接（或等待发送的协程）。
+        bool hasConnections() const noexcept {
+            return maybeConnected();
+        }
+
+    protected:
+        // 信号所属的对象。
+        Object* parent() const noexcept {
+            uintptr_t value = m_data.load(std::memory_order_acquire);
+            return (value & EmptyTag) ? reinterpret_cast<Object*>(value & ~EmptyTag) : reinterpret_cast<SignalData*>(value)->parent;
+        }
+
+        // 发送前的快速判断，不进入纪元，也不构造参数数组。没有连接过或连接已全部移除，且没有等待的协程时返回 false。
+        bool maybeConnected() const noexcept {
+            uintptr_t value = m_data.load(std::memory_order_acquire);
+            if (value & EmptyTag) {
+                return false;
+            }
+            auto d = reinterpret_cast<SignalData*>(value);
+            return d->live.load(std::memory_order_relaxed) || d->waiters.load(std::memory_order_relaxed);
+        }
+
+        void addWaiter(SignalWaiter* w) {
+            auto d = ensureData();
+            std::lock_guard<SpinLock> lock(d->lock);
+            auto head = d->waiters.load(std::memory_order_relaxed);
+            w->prev = nullptr;
+            w->next = head;
+            if (head) {
+                head->prev = w;
+            }
+            w->linked.store(true, std::memory_order_relaxed);
+            d->waiters.store(w, std::memory_order_relaxed);
+        }
+
+        void removeWaiter(SignalWaiter* w) noexcept {
+            auto d = data();
+            std::lock_guard<SpinLock> lock(d->lock);
+            if (!w->linked.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (w->prev) {
+                w->prev->next = w->next;
+            }
+            else {
+                d->waiters.store(w->next, std::memory_order_relaxed);
+            }
+            if (w->next) {
+                w->next->prev = w->prev;
+            }
+            w->linked.store(false, std::memory_order_relaxed);
+        }
+
+        // 取下所有等待者，按 co_await 的先后恢复。恢复后的协程再次 co_await 时等待的是下一次发送。
+        // 恢复的协程可能删除发送者，这里和调用者在恢复之后都只使用 d，不再访问 this。
+        static void resumeWaiters(SignalData* d, void** args) {
+            if (!d->waiters.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            SignalWaiter* head = nullptr;
+            {
+                std::lock_guard<SpinLock> lock(d->lock);
+                // 链表头是最后加入的等待者，反转成先来先恢复。
+                auto w = d->waiters.exchange(nullptr, std::memory_order_relaxed);
+                while (w) {
+                    auto next = w->next;
+                    w->next = head;
+                    w->linked.store(false, std::memory_order_release);
+                    head = w;
+                    w = next;
+                }
+            }
+
+            SenderGuard sender(d->parent);
+            while (head) {
+                auto next = head->next;
+                head->resume(head, args);
+                head = next;
+            }
+        }
+
+        // 先恢复等待的协程，再调用槽。move 为 true 时参数由调用者交出，最后一个槽可以移动按值传递的参数，前面的槽仍然看到原值。
+        // Combined 为 true 时由 collector 收集同步调用的槽的返回值，可以提前结束遍历。
+        // SignalData 只读取一次，纪元保证它在整个发送期间有效。协程或槽删除了发送者时析构已断开所有连接，
+        // 后面的槽不再调用，之后也不再访问 this。不内联，以免发送者在判断有没有连接之前就为这里保存寄存器、分配栈帧。
+        template<bool Combined = false, typename Policy = threading::Default>
+        OBJECT_NOINLINE void invokeSlots(void** args, bool move, ResultCollector* collector = nullptr) {
+            auto d = data();
+            if (!d) {
+                return;
+            }
+
+            EmitGuard<Policy> guard;
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+            auto stats = m_stats;
+#endif
+            resumeWaiters(d, args);
+            auto list = d->list.load();
+            if (!list) {
+                return;
+            }
+
+            SenderGuard sender(d->parent);
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+            EmitProbe probe(stats);
+#endif
+            size_t count = 0;
+            size_t size = list->size.load(std::memory_order_acquire);
+            size_t last = SIZE_MAX;
+            if (move) {
+                for (size_t i = size; i > 0; --i) {
+                    if (list->states[i - 1].load(std::memory_order_relaxed) == Connection::StateAlive) {
+                        last = i - 1;
+                        break;
+                    }
+                }
+            }
+
+            // 只有遇到 Parallel 连接时才构造，不影响其他发送。
+            LazyParallelEmit parallel;
+            for (size_t i = 0; i < size; ++i) {
+                uint8_t state = list->states[i].load(std::memory_order_relaxed);
+                if (state != Connection::StateAlive) {
+                    if (!(state & Connection::StateAlive)) {
+                        ++count;
+                    }
+                    continue;
+                }
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+                ++probe.fanout;
+#endif
+
+                EmitEntry& entry = list->entries[i];
+                if (!Combined && entry.type == ConnecttionType::Parallel) {
+                    if (auto conn = list->items[i].load(std::memory_order_relaxed)) {
+                        if (!parallel) {
+                            parallel.emplace(d->parent, args, size - i);
+                        }
+                        parallel->submit(entry.slot.empty() ? &conn->slot : &entry.slot, entry.recver);
+                    }
+                    continue;
+                }
+                if (i == last && parallel) {
+                    // 并行的槽可能还在读取参数，移动之前等待它们完成。
+                    parallel->join();
+                }
+
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+                SlotTimer timer(stats);
+#endif
+                if constexpr (Combined) {
+                    bool called = false;
+                    if (!entry.slot.empty() && Utils::isDirect(entry.type, entry.recver)) {
+                        entry.slot.call(entry.recver, args, i == last, collector->storage);
+                        called = true;
+                    }
+                    else if (auto conn = list->items[i].load(std::memory_order_relaxed)) {
+                        called = Utils::activate(conn, entry.type, args, i == last, collector->storage);
+                    }
+                    if (called && !collector->collect(collector)) {
+                        break;
+                    }
+                }
+                else if (!entry.slot.empty() && Utils::isDirect(entry.type, entry.recver)) {
+                    entry.slot.call(entry.recver, args, i == last);
+                }
+                else if (auto conn = list->items[i].load(std::memory_order_relaxed)) {
+                    Utils::activate(conn, entry.type, args, i == last, nullptr);
+                }
+            }
+            if (parallel) {
+                parallel->join();
+            }
+
+            if (count > size * 0.2 && d->lock.try_lock()) {
+                if (d->list.load(std::memory_order_relaxed) == list) {
+                    reallocate(d, list, nullptr, ConnecttionType::Auto, 0);
+                }
+                d->lock.unlock();
+            }
+        }
+
+        // emitBatch() 的遍历：外层是连接，内层是 count 个事件，每个槽的数据和代码只取一次。
+        // 第 k 个事件的第 j 个参数在 bases[j] + k * strides[j]，args 是 argc + 1 个元素的临时数组。
+        // 直接调用的 connectBatch() 槽以 spans 整批调用一次；其他直接调用的槽（包括 Parallel）依次调用 count 次，
+        // 槽在中途断开或被阻塞时不再调用后面的事件；Queued 和 BlockingQueued 连接逐个事件投递。
+        template<typename Policy = threading::Default>
+        void invokeSlotsBatch(size_t count, void* const* bases, const size_t* strides, size_t argc, void** spans, void** args) {
+            auto d = data();
+            if (!d) {
+                return;
+            }
+
+            auto eventArgs = [&](size_t k) {
+                for (size_t j = 0; j < argc; ++j) {
+                    args[j] = static_cast<char*>(bases[j]) + k * strides[j];
+                }
+                return args;
+            };
+
+            EmitGuard<Policy> guard;
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+            auto stats = m_stats;
+#endif
+            for (size_t k = 0; k < count && d->waiters.load(std::memory_order_relaxed); ++k) {
+                resumeWaiters(d, eventArgs(k));
+            }
+            auto list = d->list.load();
+            if (!list) {
+                return;
+            }
+
+            SenderGuard sender(d->parent);
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+            EmitProbe probe(stats);
+#endif
+            size_t size = list->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++i) {
+                if (list->states[i].load(std::memory_order_relaxed) != Connection::StateAlive) {
+                    continue;
+                }
+                EmitEntry& entry = list->entries[i];
+                Connection* conn = list->items[i].load(std::memory_order_relaxed);
+                SlotObjectBase* slot = !entry.slot.empty() ? &entry.slot : conn ? &conn->slot : nullptr;
+                if (!slot) {
+                    continue;
+                }
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+                ++probe.fanout;
+                SlotTimer timer(stats);
+#endif
+
+                bool direct = entry.type == ConnecttionType::Parallel || Utils::isDirect(entry.type, entry.recver);
+                if (direct && slot->callBatch(entry.recver, spans)) {
+                    continue;
+                }
+                for (size_t k = 0; k < count; ++k) {
+                    if (k > 0 && list->states[i].load(std::memory_order_relaxed) != Connection::StateAlive) {
+                        break;
+                    }
+                    if (direct) {
+                        slot->call(entry.recver, eventArgs(k));
+                    }
+                    else if (conn) {
+                        Utils::activate(conn, entry.type, eventArgs(k), false, nullptr);
+                    }
+                }
+            }
+        }
+
+        bool isConnectionExist(const Object* obj, void** arg, size_t hash) {
+            auto d = data();
+            if (!d) {
+                return false;
+            }
+
+            std::lock_guard<SpinLock> lock(d->lock);
+            size_t position;
+            return findConnection(d, obj, arg, hash, position) != nullptr;
+        }
+
+        bool disconnectImpl(const Object* obj, void** arg, size_t hash) {
+            auto d = data();
+            if (!d) {
+                return false;
+            }
+
+            std::lock_guard<SpinLock> lock(d->lock);
+            size_t position;
+            auto conn = findConnection(d, obj, arg, hash, position);
+            if (!conn) {
+                return false;
+            }
+
+            auto list = d->list.load(std::memory_order_relaxed);
+            if (position != SIZE_MAX) {
+                removeAt(list, position);
+            }
+            else {
+                // 通过索引找到的连接不知道在数组中的位置，只标记断开，由压缩时移除。
+                list->removeFromIndex(conn);
+                conn->disconnect();
+                ++list->removed;
+            }
+            compactIfSparse(d, list);
+            return true;
+        }
+
+        // uniqueKey 不为空时，已存在相同的连接则不创建。uniqueHash 是 slotHash(槽)。
+        // 新连接排在优先级不低于 priority 的连接之后，通常直接追加；需要插入到中间时复制数组，正在进行的发送不受影响。
+        template<typename MakeSlot>
+        ConnectionHandle createConnectImpl(const Object* obj, MakeSlot&& makeSlot, ConnecttionType type, int priority, void** uniqueKey, size_t uniqueHash) {
+            if (static_cast<int>(type) & static_cast<int>(ConnecttionType::Unique)) {
+                type = static_cast<ConnecttionType>(static_cast<int>(type) & ~static_cast<int>(ConnecttionType::Unique));
+            }
+
+            auto d = ensureData();
+            std::lock_guard<SpinLock> lock(d->lock);
+            if (uniqueKey) {
+                size_t position;
+                if (auto conn = findConnection(d, obj, uniqueKey, uniqueHash, position)) {
+                    return ConnectionHandle(conn);
+                }
+            }
+
+            auto conn = new Connection(d->parent, obj);
+            makeSlot(conn->slot);
+            if (obj) {
+                Utils::addConnection(const_cast<Object*>(obj), conn);
+            }
+
+            auto list = d->list.load(std::memory_order_relaxed);
+            size_t size = list ? list->size.load(std::memory_order_relaxed) : 0;
+            if (list && size < list->capacity && (size == 0 || list->entries[size - 1].priority >= priority)) {
+                list->assign(size, conn, type, priority, conn->slot);
+                list->size.store(size + 1, std::memory_order_release);
+                d->live.store(size + 1 - list->removed, std::memory_order_relaxed);
+            }
+            else {
+                reallocate(d, list, conn, type, priority);
+                list = d->list.load(std::memory_order_relaxed);
+            }
+
+            if (list->index) {
+                list->addToIndex(conn);
+            }
+            return ConnectionHandle(conn);
+        }
+
+    private:
+        // 以下函数需持有 d->lock。
+        // 查找与 (obj, 槽) 相等的连接。线性查找时 position 为连接在数组中的位置，通过索引找到时为 SIZE_MAX。
+        Connection* findConnection(SignalData* d, const Object* obj, void** arg, size_t hash, size_t& position) {
+            position = SIZE_MAX;
+            auto list = d->list.load(std::memory_order_relaxed);
+            if (!list || !hash) {
+                return nullptr;
+            }
+
+            size_t size = list->size.load(std::memory_order_relaxed);
+            if (!list->index && size >= ConnectionList::IndexThreshold) {
+                list->createIndex();
+            }
+
+            if (list->index) {
+                auto range = list->index->equal_range(ConnectionList::indexKey(obj, hash));
+                for (auto it = range.first; it != range.second; ++it) {
+                    auto conn = it->second;
+                    if (conn->recver == obj && conn->connected.load(std::memory_order_relaxed) && conn->slot.compare(arg)) {
+                        return conn;
+                    }
+                }
+                return nullptr;
+            }
+
+            for (size_t i = 0; i < size; ++i) {
+                auto conn = list->items[i].load(std::memory_order_relaxed);
+                if (conn && conn->recver == obj && conn->connected.load(std::memory_order_relaxed) && conn->slot.compare(arg)) {
+                    position = i;
+                    return conn;
+                }
+            }
+            return nullptr;
+        }
+
+        void removeAt(ConnectionList* list, size_t index) {
+            auto conn = list->items[index].load(std::memory_order_relaxed);
+            if (list->index) {
+                list->removeFromIndex(conn);
+            }
+            conn->disconnect();
+            conn->attach(nullptr);
+            list->items[index].store(nullptr, std::memory_order_relaxed);
+            ++list->removed;
+            g_epochDomain.retire(conn, &releaseConnection);
+        }
+
+        // 移除的连接超过一半时压缩，不依赖发送时的压缩，从不发送的信号也不会堆积空位。
+        // 全部移除时保留数组供下次连接使用，live 为 0，发送回到只判断一次的快速路径。
+        void compactIfSparse(SignalData* d, ConnectionList* list) {
+            size_t size = list->size.load(std::memory_order_relaxed);
+            if (size >= 8 && list->removed * 2 > size) {
+                reallocate(d, list, nullptr, ConnecttionType::Auto, 0);
+            }
+            else {
+                d->live.store(size - list->removed, std::memory_order_relaxed);
+            }
+        }
+
+        // 去掉已断开的连接，复制到新数组并发布，可同时追加一个连接。
+        // 没有剩下的连接时也发布一个最小容量的空数组，下次连接直接追加，不再分配。
+        static void reallocate(SignalData* d, ConnectionList* list, Connection* append, ConnecttionType type, int priority) {
+            size_t size = list ? list->size.load(std::memory_order_relaxed) : 0;
+            size_t live = 0;
+            for (size_t i = 0; i < size; ++i) {
+                auto conn = list->items[i].load(std::memory_order_relaxed);
+                if (conn && conn->connected.load(std::memory_order_relaxed)) {
+                    ++live;
+                }
+            }
+
+            auto newList = ConnectionList::create((std::max)(size_t(4), (live + 1) * 2), d->resource);
+            size_t newSize = 0;
+            size_t copied = 0;
+            for (size_t i = 0; i < size; ++i) {
+                auto conn = list->items[i].load(std::memory_order_relaxed);
+                if (!conn) {
+                    continue;
+                }
+
+                EmitEntry& entry = list->entries[i];
+                if (append && entry.priority < priority) {
+                    newList->assign(newSize++, append, type, priority, append->slot);
+                    append = nullptr;
+                }
+                if (copied < live && conn->connected.load(std::memory_order_relaxed)) {
+                    newList->assign(newSize++, conn, entry.type, entry.priority, entry.slot.empty() ? conn->slot : entry.slot);
+                    ++copied;
+                }
+                else if (list->index) {
+                    list->removeFromIndex(conn);
+                }
+            }
+
+            if (append) {
+                newList->assign(newSize++, append, type, priority, append->slot);
+            }
+            newList->size.store(newSize, std::memory_order_relaxed);
+
+            // 索引随数组转移，连接数降到阈值一半以下时丢弃。
+            if (list && list->index) {
+                if (newSize >= ConnectionList::IndexThreshold / 2) {
+                    std::swap(newList->index, list->index);
+                }
+                else {
+                    list->destroyIndex();
+                }
+            }
+            d->list.store(newList);
+            d->live.store(newSize, std::memory_order_relaxed);
+
+            if (!list) {
+                return;
+            }
+
+            // 复制到新数组的连接已指向新数组中的状态，仍指向旧数组的就是移除的连接。
+            // 先让它们不再指向旧数组，再回收旧数组。
+            for (size_t i = 0; i < size; ++i) {
+                auto conn = list->items[i].load(std::memory_order_relaxed);
+                if (conn && conn->attachedTo(&list->states[i])) {
+                    conn->disconnect();
+                    conn->attach(nullptr);
+                    g_epochDomain.retire(conn, &releaseConnection);
+                }
+            }
+            g_epochDomain.retire(list, &ConnectionList::destroy);
+        }
 
-        void operator()(Args...args) {
-            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(&args))..., 0 };
-            invokeSlots(_a);
+        static void releaseConnection(void* conn) {
+            static_cast<Connection*>(conn)->deref();
         }
 
+        static void releaseList(void* p) {
+            auto list = static_cast<ConnectionList*>(p);
+            for (size_t i = 0, n = list->size.load(std::memory_order_relaxed); i < n; ++i) {
+                if (auto conn = list->items[i].load(std::memory_order_relaxed)) {
+                    conn->deref();
+                }
+            }
+            ConnectionList::destroy(list);
+        }
+
+        SignalData* data() const noexcept {
+            uintptr_t value = m_data.load(std::memory_order_acquire);
+            return (value & EmptyTag) ? nullptr : reinterpret_cast<SignalData*>(value);
+        }
+
+        SignalData* ensureData() {
+            uintptr_t value = m_data.load(std::memory_order_acquire);
+            if (!(value & EmptyTag)) {
+                return reinterpret_cast<SignalData*>(value);
+            }
+
+            auto parent = reinterpret_cast<Object*>(value & ~EmptyTag);
+            auto d = SignalData::create(parent, Utils::memoryResource(parent));
+            if (!m_data.compare_exchange_strong(value, reinterpret_cast<uintptr_t>(d), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                SignalData::destroy(d);
+                return reinterpret_cast<SignalData*>(value);
+            }
+            return d;
+        }
+
+        // 没有连接过的信号只存放 parent 的地址，最低位置 1。第一次连接时换成 SignalData，直到信号析构。
+        static constexpr uintptr_t EmptyTag = 1;
+        std::atomic<uintptr_t> m_data;
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+        SignalStats* m_stats = nullptr;
+#endif
+    };
+
+    // 信号的连接和断开。Ret 为带返回值的信号的槽返回值类型，普通信号为 void。
+    template<typename Ret, typename... Args>
+    class SignalConnector : public SignalImplBase
+    {
+    protected:
+        using SigArgs = List<Args...>;
+        template<typename T>
+        using ParamType = std::conditional_t<std::is_reference_v<T>, T, const T&>;
+        template<typename T>
+        using RvalueParamType = std::conditional_t<std::is_reference_v<T>, T, T&&>;
+        static constexpr bool hasValueArgs = (... || !std::is_reference_v<Args>);
+
+    public:
+        using SignalImplBase::SignalImplBase;
+        using SignalImplBase::disconnect;
+
         template<typename Slot>
         bool disconnect(const typename CallableObject<remove_rv_t<Slot>>::ObjectType* obj, const Slot& slot) {
             void** _a = reinterpret_cast<void**>(const_cast<void*>(reinterpret_cast<const void*>(&slot)));
-            return disconnectImpl(obj, _a);
+            return disconnectImpl(obj, _a, slotHash(slot));
         }
 
         template<typename Slot>
@@ -602,7 +3337,7 @@ namespace objectImpl
         }
 
         template<typename Slot>
-        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType* recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) {
+        ConnectionHandle connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType* recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
             using _Slot = remove_rv_t<Slot>;
             using _CallableObject = CallableObject<_Slot>;
             static_assert(_CallableObject::isCallable, "slot is not a callable object");
@@ -615,68 +3350,509 @@ namespace objectImpl
                     static_assert(checkCompatibleArguments(LeftSigArgs{}, typename _CallableObject::ArguementTypes{}),
                         "Signal and slot arguments are not compatible.");
                 }
-                return createConnect<LeftSigArgs, Slot>(recv, std::forward<Slot>(slot), type);
+                return createConnect<LeftSigArgs, Slot>(recv, std::forward<Slot>(slot), type, priority);
             }
             else {
                 using types = ComputeFunctorArgument<Slot, SigArgs>;
                 static_assert(types::value >= 0, "Signal and slot arguments are not compatible. There is no operator() overload that can be called.");
-                return createConnect<typename types::type, Slot>(recv, std::forward<Slot>(slot));
+                return createConnect<typename types::type, Slot>(recv, std::forward<Slot>(slot), type, priority);
+            }
+        }
+
+        template<typename Slot>
+        ConnectionHandle connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            return connect(&recv, std::forward<Slot>(slot), type, priority);
+        }
+
+        /// sig.connect<&Class::func>(obj) 成员函数在编译期绑定，不存放成员函数指针，调用可以被内联。
+        template<auto Func>
+        ConnectionHandle connect(typename CallableObject<StaticSlot<Func>>::ObjectType* recv, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            static_assert(CallableObject<StaticSlot<Func>>::callableOjectType == CallableObjectType::MemberFuncion, "template argument is not a member function.");
+            return connect(recv, StaticSlot<Func>{}, type, priority);
+        }
+
+        template<auto Func>
+        ConnectionHandle connect(typename CallableObject<StaticSlot<Func>>::ObjectType& recv, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            return connect<Func>(&recv, type, priority);
+        }
+
+        /// sig.connect<&func>() 普通函数在编译期绑定。
+        template<auto Func>
+        ConnectionHandle connect(ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            static_assert(CallableObject<StaticSlot<Func>>::callableOjectType == CallableObjectType::Function, "template argument is not a function.");
+            return connect(StaticSlot<Func>{}, type, priority);
+        }
+
+        template<auto Func>
+        bool disconnect(const typename CallableObject<StaticSlot<Func>>::ObjectType* recv) {
+            return disconnect(recv, StaticSlot<Func>{});
+        }
+
+        template<auto Func>
+        bool disconnect(const typename CallableObject<StaticSlot<Func>>::ObjectType& recv) {
+            return disconnect(&recv, StaticSlot<Func>{});
+        }
+
+        template<auto Func>
+        bool disconnect() {
+            return disconnect(StaticSlot<Func>{});
+        }
+
+        template<typename Slot>
+        ConnectionHandle connect(Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            using _CallableObject = CallableObject<remove_rv_t<Slot>>;
+            static_assert(_CallableObject::callableOjectType != CallableObjectType::MemberFuncion, "member function can not use this connect.");
+            static_assert(_CallableObject::callableOjectType != CallableObjectType::Signal, "signal can not use this connect.");
+            return connect(static_cast<typename _CallableObject::ObjectType*>(nullptr), std::forward<Slot>(slot), type, priority);
+        }
+
+        /// sig.connectBatch(obj, slot) 连接按批接收的槽，slot 的参数是每个信号参数的 SignalSpan<T>。
+        /// emitBatch() 时整批调用一次，普通发送时以长度为 1 的 SignalSpan 调用。
+        template<typename Slot>
+        ConnectionHandle connectBatch(typename CallableObject<remove_rv_t<Slot>>::ObjectType* recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            using Batch = BatchSlot<remove_rv_t<Slot>, remove_rcv_t<Args>...>;
+            static_assert(std::is_void_v<Ret>, "connectBatch() is only available for signals without a result.");
+            static_assert(CallableObject<Batch>::isCallable, "The slot cannot be called with SignalSpan<T>... of the signal arguments.");
+            return createConnect<SigArgs>(recv, Batch{ std::forward<Slot>(slot) }, type, priority);
+        }
+
+        template<typename Slot>
+        ConnectionHandle connectBatch(typename CallableObject<remove_rv_t<Slot>>::ObjectType& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            return connectBatch(&recv, std::forward<Slot>(slot), type, priority);
+        }
+
+        template<typename Slot>
+        ConnectionHandle connectBatch(Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            using _CallableObject = CallableObject<remove_rv_t<Slot>>;
+            static_assert(_CallableObject::callableOjectType != CallableObjectType::MemberFuncion, "member function can not use this connect.");
+            return connectBatch(static_cast<typename _CallableObject::ObjectType*>(nullptr), std::forward<Slot>(slot), type, priority);
+        }
+
+        template<typename Obj, typename Slot>
+        std::enable_if_t<!std::is_base_of_v<Object, remove_rcv_t<std::remove_pointer_t<remove_rcv_t<Obj>>>>, bool>
+            connect(Obj&& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) const {
+            static_assert(dependent_false<Obj>, "The first parameter is not a subclass of Object");
+            return false;
+        }
+
+        template<typename Slot>
+        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType* recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) const {
+            static_assert(dependent_false<Slot>, "signal cannot be constant member");
+            return false;
+        }
+
+        template<typename Slot>
+        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) const {
+            static_assert(dependent_false<Slot>, "signal cannot be constant member");
+            return false;
+        }
+
+        template<typename Slot>
+        bool connect(Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) const {
+            static_assert(dependent_false<Slot>, "signal cannot be constant member");
+            return false;
+        }
+
+    private:
+        template<typename SigArgs, typename Slot>
+        inline ConnectionHandle createConnect(const Object* obj, Slot&& slot, ConnecttionType type = ConnecttionType::Auto, int priority = 0) {
+            void** _a = nullptr;
+            size_t hash = 0;
+            if (static_cast<int>(type) & static_cast<int>(ConnecttionType::Unique)) {
+                _a = reinterpret_cast<void**>(const_cast<void*>(reinterpret_cast<const void*>(&slot)));
+                hash = slotHash(slot);
+            }
+
+            using _Slot = remove_rv_t<Slot>;
+            return createConnectImpl(obj, [&](SlotObjectBase& slotObj) { SlotObject<_Slot, SigArgs, Ret>::create(slotObj, std::forward<Slot>(slot)); }, type, priority, _a, hash);
+        }
+    };
+
+    // 普通信号的发送。Policy 为线程模型，Args 为信号参数。
+    template<typename Policy, typename... Args>
+    class BasicSignal : public SignalConnector<void, Args...>
+    {
+        using Base = SignalConnector<void, Args...>;
+        template<typename T>
+        using ParamType = typename Base::template ParamType<T>;
+        template<typename T>
+        using RvalueParamType = typename Base::template RvalueParamType<T>;
+
+    public:
+        using Base::Base;
+
+        // 按值传递的参数以 const 引用接收，发送时不再复制。所有这类参数都是右值时，最后一个槽可以移动它们。
+        // invokeSlots() 不内联，没有连接时这里只有 maybeConnected() 的读取和判断，不保存寄存器。
+        void operator()(ParamType<Args>... args) const {
+            if (!this->maybeConnected()) {
+                return;
+            }
+            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(std::addressof(args)))..., 0 };
+            const_cast<BasicSignal*>(this)->template invokeSlots<false, Policy>(_a, false);
+        }
+
+        template<bool HasValueArgs = Base::hasValueArgs, std::enable_if_t<HasValueArgs, int> = 0>
+        void operator()(RvalueParamType<Args>... args) const {
+            if (!this->maybeConnected()) {
+                return;
+            }
+            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(std::addressof(args)))..., 0 };
+            const_cast<BasicSignal*>(this)->template invokeSlots<false, Policy>(_a, true);
+        }
+
+        /// 发送 count 个事件，第 k 个事件的参数是 (data[k]...)。与按顺序发送 count 次等价，但逐个槽遍历：
+        /// 每个槽依次处理所有事件后才调用下一个槽，connectBatch() 连接的槽整批调用一次。参数不会被移动。
+        void emitBatch(size_t count, const remove_rcv_t<Args>*... data) const {
+            static_assert(acceptsRvalues(List<Args...>{}), "emitBatch() cannot pass non-const lvalue reference arguments.");
+            if (!count || !this->maybeConnected()) {
+                return;
+            }
+            emitBatchImpl(count, std::index_sequence_for<Args...>{}, data...);
+        }
+
+        /// 每个参数一个数组（SignalSpan、std::vector、std::array、std::span），长度必须相同。
+        void emitBatch(Span<remove_rcv_t<Args>>... data) const {
+            if constexpr (sizeof...(Args) > 0) {
+                size_t count = (std::min)({ data.size()... });
+                assert(((data.size() == count) && ...) && "emitBatch() arrays must have the same length.");
+                emitBatch(count, data.data()...);
+            }
+        }
+
+#ifdef OBJECT_HAS_COROUTINES
+        // co_await obj->signal_name 挂起协程直到下一次发送，结果是参数副本组成的 tuple。
+        SignalAwaiter<Args...> operator co_await() const noexcept {
+            return SignalAwaiter<Args...>(const_cast<BasicSignal*>(this));
+        }
+#endif
+
+    private:
+        template<size_t... Index>
+        void emitBatchImpl(size_t count, std::index_sequence<Index...>, const remove_rcv_t<Args>*... data) const {
+            std::tuple<Span<remove_rcv_t<Args>>...> spans{ Span<remove_rcv_t<Args>>(data, count)... };
+            void* _spans[] = { static_cast<void*>(&std::get<Index>(spans))..., 0 };
+            void* _bases[] = { const_cast<void*>(static_cast<const void*>(data))..., 0 };
+            static constexpr size_t strides[] = { sizeof(remove_rcv_t<Args>)..., 0 };
+            void* _a[sizeof...(Args) + 1] = {};
+            const_cast<BasicSignal*>(this)->template invokeSlotsBatch<Policy>(count, _bases, strides, sizeof...(Args), _spans, _a);
+        }
+    };
+
+    // Signal(name, type1, ...) 的类型。第一个参数是 threading::SingleThreaded 或 threading::MultiThreaded 时指定线程模型。
+    template<typename... Args>
+    class SignalImpl : public BasicSignal<threading::Default, Args...> {
+        using BasicSignal<threading::Default, Args...>::BasicSignal;
+    };
+
+    template<typename... Args>
+    class SignalImpl<threading::SingleThreaded, Args...> : public BasicSignal<threading::SingleThreaded, Args...> {
+        using BasicSignal<threading::SingleThreaded, Args...>::BasicSignal;
+    };
+
+    template<typename... Args>
+    class SignalImpl<threading::MultiThreaded, Args...> : public BasicSignal<threading::MultiThreaded, Args...> {
+        using BasicSignal<threading::MultiThreaded, Args...>::BasicSignal;
+    };
+
+    // DeferredSignal(name, type1, ...) 的类型。发送只保存参数的副本（覆盖上一次未发送的），第一次保存时挂到发送者所属的 EventLoop 上，
+    // 在 flushDeferred() 或 flush() 时以最后一次的参数发送一次。没有连接时发送什么也不做。
+    template<typename... Args>
+    class DeferredSignalImpl : public BasicSignal<threading::Default, Args...>, private DeferredNode
+    {
+        using Base = BasicSignal<threading::Default, Args...>;
+        using Connector = SignalConnector<void, Args...>;
+        using Values = std::tuple<remove_rcv_t<Args>...>;
+        template<typename T>
+        using ParamType = typename Connector::template ParamType<T>;
+        template<typename T>
+        using RvalueParamType = typename Connector::template RvalueParamType<T>;
+        // 发送保存的参数时按值传递的参数交给槽移动，引用参数仍按左值传递。
+        template<typename T>
+        using StoredType = std::conditional_t<std::is_reference_v<T>, remove_rcv_t<T>&, remove_rcv_t<T>&&>;
+
+        static_assert((... && std::is_copy_constructible_v<remove_rcv_t<Args>>), "DeferredSignal requires copy constructible arguments.");
+
+    public:
+        template<typename... T>
+        explicit DeferredSignalImpl(Object* parent, T&&... site) : Base(parent, std::forward<T>(site)...), DeferredNode(&flushImpl) {}
+
+        ~DeferredSignalImpl() {
+            if (auto loop = DeferredNode::loop) {
+                loop->cancelDeferred(this);
+            }
+        }
+
+        void operator()(ParamType<Args>... args) const {
+            store(args...);
+        }
+
+        template<bool HasValueArgs = Connector::hasValueArgs, std::enable_if_t<HasValueArgs, int> = 0>
+        void operator()(RvalueParamType<Args>... args) const {
+            store(std::forward<RvalueParamType<Args>>(args)...);
+        }
+
+        /// 与依次发送 count 次等价：只保存最后一个事件的参数，之后发送一次。
+        void emitBatch(size_t count, const remove_rcv_t<Args>*... data) const {
+            if (count) {
+                store(data[count - 1]...);
+            }
+        }
+
+        void emitBatch(Span<remove_rcv_t<Args>>... data) const {
+            if constexpr (sizeof...(Args) > 0) {
+                size_t count = (std::min)({ data.size()... });
+                assert(((data.size() == count) && ...) && "emitBatch() arrays must have the same length.");
+                emitBatch(count, data.data()...);
+            }
+        }
+
+        /// 立即发送保存的参数，不等 flushDeferred()。没有待发送的参数时返回 false。
+        bool flush() {
+            if (auto loop = DeferredNode::loop) {
+                loop->cancelDeferred(this);
+            }
+            return flushPending();
+        }
+
+        bool isPending() const {
+            std::lock_guard<SpinLock> lock(m_lock);
+            return m_pending.has_value();
+        }
+
+    private:
+        template<typename... T>
+        void store(T&&... args) const {
+            if (!this->maybeConnected()) {
+                return;
+            }
+            bool post;
+            {
+                std::lock_guard<SpinLock> lock(m_lock);
+                post = !m_pending;
+                if (m_pending) {
+                    *m_pending = std::forward_as_tuple(std::forward<T>(args)...);
+                }
+                else {
+                    m_pending.emplace(std::forward<T>(args)...);
+                }
+            }
+            if (post) {
+                Utils::threadOf(this->parent())->postDeferred(const_cast<DeferredSignalImpl*>(this));
+            }
+        }
+
+        // 先从列表中摘下再取参数，取走之后的发送会重新挂上，不会丢失。
+        bool flushPending() {
+            std::optional<Values> values;
+            {
+                std::lock_guard<SpinLock> lock(m_lock);
+                values.swap(m_pending);
+            }
+            if (!values) {
+                return false;
+            }
+            emitValues(*values, std::index_sequence_for<Args...>{});
+            return true;
+        }
+
+        template<size_t... Index>
+        void emitValues(Values& values, std::index_sequence<Index...>) {
+            Base::operator()(static_cast<StoredType<Args>>(std::get<Index>(values))...);
+        }
+
+        static bool flushImpl(DeferredNode* this_) {
+            return static_cast<DeferredSignalImpl*>(this_)->flushPending();
+        }
+
+        mutable SpinLock m_lock;
+        mutable std::optional<Values> m_pending;
+    };
+
+    template<>
+    class DeferredSignalImpl<void> :public DeferredSignalImpl<> {
+        using DeferredSignalImpl<>::DeferredSignalImpl;
+    };
+
+#ifdef OBJECT_HAS_COROUTINES
+    // 等待者是 co_await 表达式的临时对象，随协程帧分配，不创建 Connection，也不分配堆内存。
+    // 在发送线程中、本次发送的槽被调用之前恢复协程；信号先析构时以 std::nullopt 恢复。
+    // 协程在挂起时被销毁，等待者从信号上摘下。
+    template<typename... Args>
+    class SignalAwaiter : private SignalWaiter
+    {
+    public:
+        using value_type = std::optional<std::tuple<remove_rcv_t<Args>...>>;
+
+        explicit SignalAwaiter(SignalImplBase* signal) noexcept : SignalWaiter(&SignalAwaiter::resumeImpl), m_signal(signal) {}
+        SignalAwaiter(const SignalAwaiter&) = delete;
+        SignalAwaiter& operator=(const SignalAwaiter&) = delete;
+
+        ~SignalAwaiter() {
+            if (linked.load(std::memory_order_acquire)) {
+                m_signal->removeWaiter(this);
+            }
+        }
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_handle = handle;
+            m_signal->addWaiter(this);
+        }
+
+        value_type await_resume() {
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+            return std::move(m_result);
+        }
+
+    private:
+        static void resumeImpl(SignalWaiter* this_, void** args) {
+            auto self = static_cast<SignalAwaiter*>(this_);
+            if (args) {
+                try {
+                    self->emplace(args, std::index_sequence_for<Args...>{});
+                }
+                catch (...) {
+                    self->m_error = std::current_exception();
+                }
+            }
+            self->m_handle.resume();
+        }
+
+        template<size_t... Index>
+        void emplace(void** args, std::index_sequence<Index...>) {
+            m_result.emplace(Argument<Args>::get(args[Index])...);
+        }
+
+        SignalImplBase* const m_signal;
+        std::coroutine_handle<> m_handle;
+        value_type m_result;
+        std::exception_ptr m_error;
+    };
+#endif
+
+    template<>
+    class SignalImpl<void> :public SignalImpl<> {
+        using SignalImpl<>::SignalImpl;
+    };
+
+    // 带返回值的信号。槽的返回值转换为 Combiner::value_type 后依次交给 combiner.add()，
+    // add() 返回 false 时不再调用后面的槽，发送返回 combiner.result()。
+    // 只收集在发送返回前调用的槽（直接调用、BlockingQueued），Parallel 连接按顺序直接调用。
+    template<typename Combiner, typename... Args>
+    class CombinedSignalImpl : public SignalConnector<typename Combiner::value_type, Args...>
+    {
+        using Base = SignalConnector<typename Combiner::value_type, Args...>;
+        using ValueType = typename Combiner::value_type;
+        using ResultType = decltype(std::declval<Combiner&>().result());
+        template<typename T>
+        using ParamType = typename Base::template ParamType<T>;
+        template<typename T>
+        using RvalueParamType = typename Base::template RvalueParamType<T>;
+
+    public:
+        using Base::Base;
+
+        ResultType operator()(ParamType<Args>... args) const {
+            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(std::addressof(args)))..., 0 };
+            return invoke(_a, false);
+        }
+
+        template<bool HasValueArgs = Base::hasValueArgs, std::enable_if_t<HasValueArgs, int> = 0>
+        ResultType operator()(RvalueParamType<Args>... args) const {
+            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(std::addressof(args)))..., 0 };
+            return invoke(_a, true);
+        }
+
+    private:
+        struct Collector : public ResultCollector
+        {
+            Collector() noexcept : ResultCollector{ value, &collectValue } {}
+
+            static bool collectValue(ResultCollector* this_) {
+                auto _this = static_cast<Collector*>(this_);
+                auto p = std::launder(reinterpret_cast<ValueType*>(_this->value));
+                ValueType v(std::move(*p));
+                p->~ValueType();
+                return _this->combiner.add(std::move(v));
             }
-        }
 
-        template<typename Slot>
-        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) {
-            return connect(&recv, std::forward<Slot>(slot), type);
-        }
+            Combiner combiner{};
+            alignas(ValueType) unsigned char value[sizeof(ValueType)];
+        };
 
-        template<typename Slot>
-        bool connect(Slot&& slot, ConnecttionType type = ConnecttionType::Auto) {
-            using _CallableObject = CallableObject<remove_rv_t<Slot>>;
-            static_assert(_CallableObject::callableOjectType != CallableObjectType::MemberFuncion, "member function can not use this connect.");
-            static_assert(_CallableObject::callableOjectType != CallableObjectType::Signal, "signal can not use this connect.");
-            return connect(static_cast<typename _CallableObject::ObjectType*>(nullptr), std::forward<Slot>(slot), type);
+        ResultType invoke(void** args, bool move) const {
+            Collector collector;
+            if (this->maybeConnected()) {
+                const_cast<CombinedSignalImpl*>(this)->template invokeSlots<true>(args, move, &collector);
+            }
+            return collector.combiner.result();
         }
+    };
 
-        template<typename Obj, typename Slot>
-        std::enable_if_t<!std::is_base_of_v<Object, remove_rcv_t<std::remove_pointer_t<Obj>>>, bool>
-            connect(Obj&& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) const {
-            static_assert(false, "The first parameter is not a subclass of Object");
-        }
+    template<typename Combiner>
+    class CombinedSignalImpl<Combiner, void> :public CombinedSignalImpl<Combiner> {
+        using CombinedSignalImpl<Combiner>::CombinedSignalImpl;
+    };
 
-        template<typename Slot>
-        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType* recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) const {
-            static_assert(false, "signal cannot be constant member");
-        }
+    // 槽在编译期固定的信号。Slots 是 &Class::func 或 &func，接收者在构造时按槽的顺序给出，普通函数对应 nullptr。
+    // 发送展开为对每个槽的直接调用，没有类型擦除、连接数组和内存分配，调用可以被内联。
+    // 槽参数的截断和兼容性检查与 connect 相同。接收者析构时不会自动断开，必须比信号活得长。
+    template<typename Signature, auto... Slots>
+    class StaticSignalImpl;
 
-        template<typename Slot>
-        bool connect(typename CallableObject<remove_rv_t<Slot>>::ObjectType& recv, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) const {
-            static_assert(false, "signal cannot be constant member");
+    template<typename... Args, auto... Slots>
+    class StaticSignalImpl<void(Args...), Slots...>
+    {
+        using SigArgs = List<Args...>;
+        template<auto Slot>
+        using SlotInfo = CallableObject<StaticSlot<Slot>>;
+        template<typename T>
+        using ParamType = std::conditional_t<std::is_reference_v<T>, T, const T&>;
+
+    public:
+        explicit StaticSignalImpl(Object* parent, typename SlotInfo<Slots>::ObjectType*... recvs) noexcept
+            : m_parent(parent), m_recvs(recvs...) {
         }
 
-        template<typename Slot>
-        bool connect(Slot&& slot, ConnecttionType type = ConnecttionType::Auto) const {
-            static_assert(false, "signal cannot be constant member");
+        StaticSignalImpl(const StaticSignalImpl&) = delete;
+        StaticSignalImpl& operator=(const StaticSignalImpl&) = delete;
+
+        void operator()(ParamType<Args>... args) const {
+            void* _a[] = { const_cast<void*>(reinterpret_cast<const void*>(std::addressof(args)))..., 0 };
+            SenderGuard sender(m_parent);
+            invoke(_a, std::make_index_sequence<sizeof...(Slots)>{});
         }
 
     private:
-        template<typename SigArgs, typename Slot>
-        inline bool createConnect(const Object* obj, Slot&& slot, ConnecttionType type = ConnecttionType::Auto) {
-            if (type == ConnecttionType::Unique) {
-                void** _a = reinterpret_cast<void**>(const_cast<void*>(reinterpret_cast<const void*>(&slot)));
-                if (isConnectionExist(obj, _a)) {
-                    return true;
-                }
-            }
+        template<size_t... Index>
+        void invoke(void** args, std::index_sequence<Index...>) const {
+            (call<Slots>(std::get<Index>(m_recvs), args), ...);
+        }
 
-            using _Slot = remove_rv_t<Slot>;
-            auto slotObj = new SlotObject<_Slot, SigArgs>(std::forward<Slot>(slot));
-            return createConnectImpl(obj, slotObj, type);
+        template<auto Slot>
+        static void call(typename SlotInfo<Slot>::ObjectType* recv, void** args) {
+            using _CallableObject = SlotInfo<Slot>;
+            static_assert(_CallableObject::isCallable, "slot is not a function or member function.");
+            static_assert(SigArgs::size >= _CallableObject::ArguementTypes::size, "The slot requires more arguments than the signal provides.");
+
+            using LeftSigArgs = decltype(List_Left<SigArgs, _CallableObject::ArguementTypes::size>());
+            if constexpr (LeftSigArgs::size > 0) {
+                static_assert(checkCompatibleArguments(LeftSigArgs{}, typename _CallableObject::ArguementTypes{}),
+                    "Signal and slot arguments are not compatible.");
+            }
+            if constexpr (_CallableObject::callableOjectType == CallableObjectType::MemberFuncion) {
+                assert(recv);
+            }
+            _CallableObject::call(StaticSlot<Slot>{}, recv, args, LeftSigArgs{}, std::make_index_sequence<LeftSigArgs::size>{});
         }
-    };
 
-    template<>
-    class SignalImpl<void> :public SignalImpl<> {
-        using SignalImpl<>::SignalImpl;
+        Object* const m_parent;
+        const std::tuple<typename SlotInfo<Slots>::ObjectType*...> m_recvs;
     };
 
     template <typename... Args>
@@ -747,13 +3923,170 @@ inline Object* sender() {
     return objectImpl::g_currentSender;
 }
 
+/// 等待正在发送信号的线程结束，并释放所有已断开的连接和被替换的连接数组。
+/// 销毁对象使用的 memory_resource 之前调用。不能在槽函数中调用。
+inline void synchronizeSignals() {
+    objectImpl::g_epochDomain.synchronize();
+}
+
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+/// 按声明位置汇总的信号统计（发送次数、扇出、嵌套深度、槽耗时直方图），JSON 格式。
+/// 只统计用 Signal()/CombinedSignal() 声明的信号，没有连接时的发送不计入。
+inline std::string signalStatisticsJson() {
+    return objectImpl::StatsRegistry::instance().json();
+}
+
+/// 清零所有信号统计。
+inline void resetSignalStatistics() {
+    objectImpl::StatsRegistry::instance().reset();
+}
+#endif
+
+/// <summary>
+/// CombinedSignal 的返回值合并方式。value_type 是槽返回值转换成的类型，
+/// add() 返回 false 时结果已经确定，不再调用后面的槽，result() 是发送的返回值。
+/// </summary>
+namespace combiner
+{
+    /// 最后一个槽的返回值，没有槽被调用时为空。
+    template<typename T>
+    class Last {
+    public:
+        using value_type = T;
+
+        bool add(T&& value) {
+            m_result = std::move(value);
+            return true;
+        }
+
+        std::optional<T> result() {
+            return std::move(m_result);
+        }
+
+    private:
+        std::optional<T> m_result;
+    };
+
+    /// 按调用顺序收集所有槽的返回值。
+    template<typename T>
+    class Collect {
+    public:
+        using value_type = T;
+
+        bool add(T&& value) {
+            m_result.push_back(std::move(value));
+            return true;
+        }
+
+        std::vector<T> result() {
+            return std::move(m_result);
+        }
+
+    private:
+        std::vector<T> m_result;
+    };
+
+    /// 有槽返回 true 时结果为 true，后面的槽不再调用。
+    class FirstTrue {
+    public:
+        using value_type = bool;
+
+        bool add(bool value) noexcept {
+            m_result = value;
+            return !value;
+        }
+
+        bool result() const noexcept {
+            return m_result;
+        }
+
+    private:
+        bool m_result = false;
+    };
+
+    /// 所有槽返回值中的最小值，没有槽被调用时为空。
+    template<typename T>
+    class Min {
+    public:
+        using value_type = T;
+
+        bool add(T&& value) {
+            if (!m_result || value < *m_result) {
+                m_result = std::move(value);
+            }
+            return true;
+        }
+
+        std::optional<T> result() {
+            return std::move(m_result);
+        }
+
+    private:
+        std::optional<T> m_result;
+    };
+
+    /// 所有槽返回值中的最大值，没有槽被调用时为空。
+    template<typename T>
+    class Max {
+    public:
+        using value_type = T;
+
+        bool add(T&& value) {
+            if (!m_result || *m_result < value) {
+                m_result = std::move(value);
+            }
+            return true;
+        }
+
+        std::optional<T> result() {
+            return std::move(m_result);
+        }
+
+    private:
+        std::optional<T> m_result;
+    };
+}
+
+/// <summary>
+/// 作用域内在当前线程创建的无父对象使用 resource 分配连接数组和子对象数组，子对象沿用父对象的 resource。
+/// 例如用 std::pmr::monotonic_buffer_resource 作为整个对象树的内存池，
+/// 销毁对象树并调用 synchronizeSignals() 后再一次性释放。
+/// </summary>
+class MemoryResourceScope {
+public:
+    explicit MemoryResourceScope(std::pmr::memory_resource* resource) noexcept
+        : m_old(objectImpl::g_memoryResource) {
+        objectImpl::g_memoryResource = resource;
+    }
+
+    MemoryResourceScope(const MemoryResourceScope&) = delete;
+    MemoryResourceScope& operator=(const MemoryResourceScope&) = delete;
+
+    ~MemoryResourceScope() {
+        objectImpl::g_memoryResource = m_old;
+    }
+
+private:
+    std::pmr::memory_resource* m_old;
+};
+
+#ifdef SIGNAL_SLOT_INSTRUMENTATION
+#define Signal(name, ...) objectImpl::SignalImpl<__VA_ARGS__> name{this, objectImpl::SignalSite{#name, __FILE__, __LINE__}};
+#define CombinedSignal(name, Combiner, ...) objectImpl::CombinedSignalImpl<Combiner, __VA_ARGS__> name{this, objectImpl::SignalSite{#name, __FILE__, __LINE__}};
+#define DeferredSignal(name, ...) objectImpl::DeferredSignalImpl<__VA_ARGS__> name{this, objectImpl::SignalSite{#name, __FILE__, __LINE__}};
+#else
 #define Signal(name, ...) objectImpl::SignalImpl<__VA_ARGS__> name{this};
+#define CombinedSignal(name, Combiner, ...) objectImpl::CombinedSignalImpl<Combiner, __VA_ARGS__> name{this};
+#define DeferredSignal(name, ...) objectImpl::DeferredSignalImpl<__VA_ARGS__> name{this};
+#endif
 #define emit
 #define slots
 
 class Object {
 public:
-    explicit Object(Object* parent = nullptr) {
+    explicit Object(Object* parent = nullptr)
+        : m_loop(EventLoop::current()), m_resource(initialResource(parent)) {
+        m_loop.load(std::memory_order_relaxed)->ref();
         setParent(parent);
     }
 
@@ -762,14 +4095,15 @@ public:
 
     virtual ~Object() {
         emit destory(this);
-        for (auto child : m_children) {
-            if (child) {
-                delete child;
-            }
-        }
-        m_children.clear();
+        // 子对象析构时会从 m_children 中删除自己，也可能删除其他子对象，这期间不压缩数组。
+        m_destroying = true;
+        m_children.forEach([](Object* child) {
+            delete child;
+        });
+        m_children.clear(m_resource);
         setParent(nullptr);
         disconnect();
+        m_loop.load(std::memory_order_relaxed)->deref();
     }
 
     void setParent(Object* parent) {
@@ -779,19 +4113,39 @@ public:
 
         if (m_parent) {
             auto& children = m_parent->m_children;
-            auto iter = std::find(children.begin(), children.end(), this);
-            if (iter != children.end()) {
-                *iter = nullptr;
-            }
-            else {
-                assert(false);
+            assert(children.at(m_indexInParent) == this);
+            children.erase(m_indexInParent);
+            if (!m_parent->m_destroying) {
+                children.shrink(m_parent->m_resource, [](Object* child, size_t index) {
+                    child->m_indexInParent = static_cast<uint32_t>(index);
+                });
             }
         }
 
         m_parent = parent;
         if (parent) {
-            objectImpl::Utils::addChild(parent->m_children, this);
+            assert(parent->thread() == thread() && "The parent must be in the same thread.");
+            m_indexInParent = static_cast<uint32_t>(objectImpl::Utils::addChild(parent->m_children, this, parent->m_resource));
+        }
+    }
+
+    /// 分配连接数组和子对象数组所用的 memory_resource。
+    std::pmr::memory_resource* memoryResource() const noexcept {
+        return m_resource;
+    }
+
+    EventLoop* thread() const noexcept {
+        return m_loop.load(std::memory_order_relaxed);
+    }
+
+    /// 改变此对象及其子对象的线程。有父对象的对象不能移动。
+    void moveToThread(EventLoop* loop) {
+        assert(loop);
+        assert(!m_parent && "Cannot move objects with a parent.");
+        if (!loop || m_parent) {
+            return;
         }
+        setThread(loop);
     }
 
     bool disconnect(const Object* obj) {
@@ -799,42 +4153,415 @@ public:
             return false;
         }
 
+        // 连接在放开锁之后释放，槽对象析构时可能再访问这个对象。每次最多取出 BatchSize 个放在栈上，不分配内存。
+        constexpr size_t BatchSize = 32;
+        objectImpl::Connection* conns[BatchSize];
         bool res = false;
-        for (auto& conn : m_connections) {
-            if (conn && conn->sender == obj) {
-                conn->release();
-                conn = nullptr;
-                res = true;
+        size_t count;
+        do {
+            count = 0;
+            {
+                std::lock_guard<objectImpl::SpinLock> lock(m_connLock);
+                for (size_t i = 0, n = m_connections.extent(); i < n && count < BatchSize; ++i) {
+                    auto conn = m_connections.at(i);
+                    if (conn && conn->sender == obj) {
+                        conns[count++] = conn;
+                        m_connections.erase(i);
+                    }
+                }
+                if (count < BatchSize) {
+                    m_connections.shrink(m_resource, [](objectImpl::Connection*, size_t) {});
+                }
             }
-        }
+
+            for (size_t i = 0; i < count; ++i) {
+                conns[i]->release();
+            }
+            res = res || count;
+        } while (count == BatchSize);
         return res;
     }
 
     bool disconnect() {
-        for (auto& conn : m_connections) {
-            conn->release();
+        objectImpl::PointerArray<objectImpl::Connection*> conns;
+        {
+            std::lock_guard<objectImpl::SpinLock> lock(m_connLock);
+            conns.swap(m_connections);
         }
-        bool res = !m_connections.empty();
-        m_connections.clear();
+
+        conns.forEach([](objectImpl::Connection* conn) {
+            conn->release();
+        });
+        bool res = !conns.empty();
+        conns.clear(m_resource);
         return res;
     }
 
     Signal(destory, Object*)
 private:
     friend bool objectImpl::Utils::addConnection(Object* obj, objectImpl::Connection* conn);
+    friend EventLoop* objectImpl::Utils::threadOf(const Object* obj) noexcept;
+
+    static std::pmr::memory_resource* initialResource(Object* parent) noexcept {
+        if (parent) {
+            return parent->memoryResource();
+        }
+        return objectImpl::g_memoryResource ? objectImpl::g_memoryResource : std::pmr::get_default_resource();
+    }
+
+    void setThread(EventLoop* loop) {
+        loop->ref();
+        m_loop.exchange(loop)->deref();
+        m_children.forEach([loop](Object* child) {
+            child->setThread(loop);
+        });
+    }
 
+    std::atomic<EventLoop*> m_loop;
     Object* m_parent = nullptr;
-    std::vector<objectImpl::Connection*> m_connections;
-    std::vector<Object*> m_children;
+    std::pmr::memory_resource* const m_resource;
+    objectImpl::PointerArray<objectImpl::Connection*> m_connections;
+    objectImpl::PointerArray<Object*> m_children;
+    objectImpl::SpinLock m_connLock;
+    bool m_destroying = false;
+    uint32_t m_indexInParent = 0;
 };
 
+// 没有连接的信号只占一个指针，Object 不超过一个缓存行。统计打开时每个信号多一个指针。
+#ifndef SIGNAL_SLOT_INSTRUMENTATION
+static_assert(sizeof(objectImpl::SignalImpl<int>) == sizeof(void*), "an unconnected signal should cost one pointer");
+static_assert(sizeof(Object) <= 8 * sizeof(void*), "Object footprint regression");
+#endif
+
 namespace objectImpl {
     bool Utils::addConnection(Object* obj, Connection* conn) {
-        objectImpl::Utils::addConnection(obj->m_connections, conn);
+        std::lock_guard<objectImpl::SpinLock> lock(obj->m_connLock);
+        objectImpl::Utils::addConnection(obj->m_connections, conn, obj->m_resource);
         return true;
     }
+
+    EventLoop* Utils::threadOf(const Object* obj) noexcept {
+        return obj->m_loop.load(std::memory_order_relaxed);
+    }
+
+    std::pmr::memory_resource* Utils::memoryResource(const Object* obj) noexcept {
+        return obj->memoryResource();
+    }
+}
+
+class Timer;
+
+namespace objectImpl
+{
+    // 时间轮槽中的双向循环链表节点，槽本身是哨兵节点，摘下时不需要知道所在的槽。
+    struct TimerNode
+    {
+        TimerNode* prev = this;
+        TimerNode* next = this;
+        Timer* owner = nullptr;
+
+        bool linked() const noexcept {
+            return next != this;
+        }
+
+        void unlink() noexcept {
+            prev->next = next;
+            next->prev = prev;
+            prev = next = this;
+        }
+
+        void pushBack(TimerNode* node) noexcept {
+            node->prev = prev;
+            node->next = this;
+            prev->next = node;
+            prev = node;
+        }
+    };
+}
+
+/// <summary>
+/// 分层时间轮。4 层，每层 256 个槽，第 k 层的一个槽覆盖 256^k 个 tick，最远 2^32 个 tick，更远的定时器到时再重新放入。
+/// 启动和停止定时器都是 O(1)，定时器的节点在 Timer 内部，重新启动不分配内存。
+/// advance(n) 手动前进 n 个 tick，测试中不需要等待真实时间；update() 按 steady_clock 前进到当前时间。
+/// 时间轮和它的定时器只在一个线程中使用，不能在 timeout 的槽中调用 advance()。
+/// </summary>
+class TimerWheel {
+public:
+    explicit TimerWheel(std::chrono::steady_clock::duration tick = std::chrono::milliseconds(1))
+        : m_tick(tick), m_start(std::chrono::steady_clock::now()) {
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    ~TimerWheel();
+
+    /// 已经经过的 tick 数。
+    uint64_t now() const noexcept {
+        return m_now;
+    }
+
+    std::chrono::steady_clock::duration tickDuration() const noexcept {
+        return m_tick;
+    }
+
+    /// 正在运行的定时器个数。
+    size_t size() const noexcept {
+        return m_count;
+    }
+
+    /// 前进 ticks 个 tick，依次发送到期定时器的 timeout。返回到期的定时器个数。
+    size_t advance(uint64_t ticks = 1);
+
+    /// 前进到 steady_clock 的当前时间。
+    size_t update() {
+        auto target = static_cast<uint64_t>((std::chrono::steady_clock::now() - m_start) / m_tick);
+        return target > m_now ? advance(target - m_now) : 0;
+    }
+
+private:
+    friend class Timer;
+
+    static constexpr int Bits = 8;
+    static constexpr uint64_t SlotCount = uint64_t(1) << Bits;
+    static constexpr uint64_t SlotMask = SlotCount - 1;
+    static constexpr int Levels = 4;
+    static constexpr uint64_t MaxDelta = (uint64_t(1) << (Bits * Levels)) - 1;
+
+    void insert(objectImpl::TimerNode* node, uint64_t expires) noexcept {
+        // start() 和重新启动时 expires 总大于 m_now；只有下放时会遇到当前 tick 到期的定时器，
+        // 放入第 0 层当前的槽，下放之后紧接着处理。
+        if (expires < m_now) {
+            expires = m_now;
+        }
+        uint64_t delta = expires - m_now;
+        if (delta > MaxDelta) {
+            delta = MaxDelta;
+            expires = m_now + MaxDelta;
+        }
+        int level = 0;
+        while (level < Levels - 1 && delta >= (uint64_t(1) << (Bits * (level + 1)))) {
+            ++level;
+        }
+        uint64_t index = (expires >> (Bits * level)) & SlotMask;
+        m_slots[level][index].pushBack(node);
+        m_occupied[level][index / 64] |= uint64_t(1) << (index % 64);
+    }
+
+    // 把高层的一个槽中的定时器按剩余时间重新放入低层。返回这一层的槽下标，为 0 时继续处理更高一层。
+    uint64_t cascade(int level) noexcept;
+
+    // 下一个需要处理的 tick：第 0 层下一个非空的槽，或者高层下一个非空的槽开始下放的 tick。
+    uint64_t nextEvent() const noexcept;
+
+    std::chrono::steady_clock::duration m_tick;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_now = 0;
+    size_t m_count = 0;
+    bool m_advancing = false;
+    objectImpl::TimerNode m_slots[Levels][SlotCount];
+    // 可能非空的槽。放入时置位，处理这个槽时清除；停止定时器时不清除，只多处理一次空槽。
+    // advance() 据此跳过没有定时器的 tick，前进的时间与经过的 tick 数无关。
+    uint64_t m_occupied[Levels][SlotCount / 64] = {};
+    // 本 tick 到期、还没有发送的定时器。发送时槽中停止的定时器从这里摘下。
+    objectImpl::TimerNode m_expired;
+};
+
+/// <summary>
+/// 时间轮驱动的定时器。start() 之后每 interval 个 tick 发送一次 timeout，setSingleShot(true) 时只发送一次。
+/// 定时器析构（包括随父对象析构）时自动停止。重复的定时器到期时 timeout 已经没有连接（接收者都已析构或断开），
+/// 定时器停止，不再占用时间轮。
+/// </summary>
+class Timer : public Object {
+public:
+    explicit Timer(TimerWheel* wheel, Object* parent = nullptr) : Object(parent), m_wheel(wheel) {
+        m_node.owner = this;
+    }
+
+    ~Timer() {
+        stop();
+    }
+
+    /// 以 interval() 启动，已经启动的定时器重新计时。
+    void start() {
+        stop();
+        if (!m_wheel) {
+            return;
+        }
+        m_expires = m_wheel->m_now + m_interval;
+        m_wheel->insert(&m_node, m_expires);
+        ++m_wheel->m_count;
+    }
+
+    /// 设置间隔（tick 数，至少为 1）并启动。
+    void start(uint64_t ticks) {
+        setInterval(ticks);
+        start();
+    }
+
+    /// 按时间轮的 tick 向上取整。
+    template<typename Rep, typename Period>
+    void start(std::chrono::duration<Rep, Period> interval) {
+        auto tick = m_wheel ? m_wheel->tickDuration() : std::chrono::steady_clock::duration(1);
+        auto d = std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+        start(static_cast<uint64_t>((d + tick - std::chrono::steady_clock::duration(1)) / tick));
+    }
+
+    void stop() noexcept {
+        if (m_node.linked()) {
+            m_node.unlink();
+            --m_wheel->m_count;
+        }
+    }
+
+    bool isActive() const noexcept {
+        return m_node.linked();
+    }
+
+    void setInterval(uint64_t ticks) noexcept {
+        m_interval = ticks ? ticks : 1;
+    }
+
+    uint64_t interval() const noexcept {
+        return m_interval;
+    }
+
+    void setSingleShot(bool singleShot) noexcept {
+        m_singleShot = singleShot;
+    }
+
+    bool isSingleShot() const noexcept {
+        return m_singleShot;
+    }
+
+    /// 距离下一次到期的 tick 数，没有启动时为 0。
+    uint64_t remainingTicks() const noexcept {
+        return isActive() && m_expires > m_wheel->m_now ? m_expires - m_wheel->m_now : 0;
+    }
+
+    Signal(timeout, void)
+
+private:
+    friend class TimerWheel;
+
+    // 从 m_expired 中取出后调用。重复的定时器先放回时间轮再发送，槽中可以 stop() 或析构定时器。
+    void fire() {
+        --m_wheel->m_count;
+        if (!timeout.hasConnections()) {
+            return;
+        }
+        if (!m_singleShot) {
+            m_expires += m_interval;
+            m_wheel->insert(&m_node, m_expires);
+            ++m_wheel->m_count;
+        }
+        emit timeout();
+    }
+
+    TimerWheel* m_wheel;
+    objectImpl::TimerNode m_node;
+    uint64_t m_expires = 0;
+    uint64_t m_interval = 1;
+    bool m_singleShot = false;
+};
+
+inline TimerWheel::~TimerWheel() {
+    for (auto& level : m_slots) {
+        for (auto& slot : level) {
+            while (slot.linked()) {
+                auto node = slot.next;
+                node->unlink();
+                node->owner->m_wheel = nullptr;
+            }
+        }
+    }
+}
+
+inline uint64_t TimerWheel::cascade(int level) noexcept {
+    uint64_t index = (m_now >> (Bits * level)) & SlotMask;
+    objectImpl::TimerNode& slot = m_slots[level][index];
+    m_occupied[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+    while (slot.linked()) {
+        auto node = slot.next;
+        node->unlink();
+        insert(node, node->owner->m_expires);
+    }
+    return index;
+}
+
+inline uint64_t TimerWheel::nextEvent() const noexcept {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < Levels; ++level) {
+        uint64_t block = m_now >> (Bits * level);
+        // 从当前槽的下一个开始循环查找，距离为 1 到 SlotCount。
+        for (uint64_t distance = 1; distance <= SlotCount;) {
+            uint64_t index = (block + distance) & SlotMask;
+            uint64_t word = m_occupied[level][index / 64] >> (index % 64);
+            if (word == 0) {
+                distance += 64 - index % 64;
+                continue;
+            }
+            int skip = 0;
+            while (!(word & 1)) {
+                word >>= 1;
+                ++skip;
+            }
+            distance += skip;
+            if (distance <= SlotCount) {
+                next = (std::min)(next, (block + distance) << (Bits * level));
+            }
+            break;
+        }
+    }
+    return next;
+}
+
+inline size_t TimerWheel::advance(uint64_t ticks) {
+    assert(!m_advancing && "TimerWheel::advance() called from a timeout slot.");
+    m_advancing = true;
+    uint64_t end = m_now + ticks;
+    size_t fired = 0;
+    while (m_now < end) {
+        uint64_t next = m_count ? nextEvent() : UINT64_MAX;
+        if (next > end) {
+            m_now = end;
+            break;
+        }
+
+        m_now = next;
+        if ((m_now & SlotMask) == 0) {
+            for (int level = 1; level < Levels && cascade(level) == 0; ++level) {
+            }
+        }
+
+        uint64_t index = m_now & SlotMask;
+        objectImpl::TimerNode& slot = m_slots[0][index];
+        m_occupied[0][index / 64] &= ~(uint64_t(1) << (index % 64));
+        while (slot.linked()) {
+            auto node = slot.next;
+            node->unlink();
+            m_expired.pushBack(node);
+        }
+        while (m_expired.linked()) {
+            auto node = m_expired.next;
+            node->unlink();
+            ++fired;
+            node->owner->fire();
+        }
+    }
+    m_advancing = false;
+    return fired;
 }
 
+/// 槽在编译期固定的信号，例如 StaticSignal<void(int), &A::onValue, &freeSlot> sig{this, &a, nullptr};
+/// 发送 emit sig(1) 依次直接调用 a.onValue(1)、freeSlot(1)，不分配内存。
+template <typename Signature, auto... Slots>
+using StaticSignal = objectImpl::StaticSignalImpl<Signature, Slots...>;
+
+/// emitBatch() 中一个参数的数组，connectBatch() 连接的槽按 SignalSpan<T> 接收。C++20 下可以转换为 std::span<const T>。
+template <typename T>
+using SignalSpan = objectImpl::Span<T>;
+
 template <typename... Args>
 constexpr objectImpl::Overload<Args...> overload = {};
 
@@ -0,0 +1,366 @@
+﻿#pragma once
+#include "object.h"
+#include <cerrno>
+#include <cstddef>
+#include <climits>
+#include <ctime>
+#include <string>
+#include <system_error>
+
+#if !defined(__linux__)
+#error "shared_signal.h requires Linux (POSIX shared memory and futex)."
+#endif
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// <summary>
+/// 同一台机器上的进程之间转发信号。
+/// SharedSignalSender<Args...> 连接本地信号，每次发送把参数写入 POSIX 共享内存中的环形队列，不经过系统调用；
+/// 对端进程的 SharedSignalReceiver<Args...> 取出参数，通过自己的 received 信号重新发送。
+/// 接收者没有在等待时发送方不做系统调用，等待中的接收者由 futex 唤醒。
+/// 参数必须可以平凡复制且不是指针。队列满时丢弃新的事件，dropped() 返回丢弃的个数。
+/// 队列可以有多个发送进程；每个事件只被一个接收者取出，多个进程都要收到时每个进程用一个队列。
+/// 共享内存对象由第一个打开的一方创建，SharedSignalSender/SharedSignalReceiver 析构时不删除，用 removeSharedSignal(name) 删除。
+/// </summary>
+namespace objectImpl
+{
+    // 共享内存中的有界 MPMC 环形队列（Vyukov），每个格子的序号表示它可写还是可读。
+    class ShmRing
+    {
+        static constexpr uint32_t Magic = 0x5349474e;
+        static constexpr int SpinCount = 256;
+
+        struct Header {
+            std::atomic<uint32_t> magic;
+            uint32_t payloadSize;
+            uint64_t capacity;
+            uint64_t cellSize;
+            alignas(64) std::atomic<uint64_t> enqueuePos;
+            alignas(64) std::atomic<uint64_t> dequeuePos;
+            alignas(64) std::atomic<uint32_t> wakeSeq;
+            std::atomic<uint32_t> waiters;
+            std::atomic<uint64_t> dropped;
+        };
+
+        struct Cell {
+            std::atomic<uint64_t> seq;
+            unsigned char data[8];
+        };
+
+        // 不同进程中的地址不同，原子变量必须是无锁的才能放在共享内存中。
+        static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free);
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+    public:
+        ShmRing(const std::string& name, size_t capacity, size_t payloadSize) {
+            size_t cap = 2;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+            m_capacity = cap;
+            m_cellSize = (offsetof(Cell, data) + payloadSize + 63) / 64 * 64;
+            m_size = (sizeof(Header) + 63) / 64 * 64 + m_cellSize * cap;
+
+            bool creator = true;
+            int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd < 0 && errno == EEXIST) {
+                creator = false;
+                fd = ::shm_open(name.c_str(), O_RDWR, 0);
+            }
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            }
+
+            if (creator) {
+                if (::ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+                    int err = errno;
+                    ::close(fd);
+                    ::shm_unlink(name.c_str());
+                    throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+                }
+            }
+            else {
+                // 创建者可能还没有设置大小。
+                struct stat st = {};
+                for (int i = 0; i < 1000 && ::fstat(fd, &st) == 0 && st.st_size == 0; ++i) {
+                    ::usleep(1000);
+                }
+                if (static_cast<size_t>(st.st_size) != m_size) {
+                    ::close(fd);
+                    throw std::system_error(EINVAL, std::generic_category(), "shared signal layout mismatch " + name);
+                }
+            }
+
+            void* mem = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            int err = errno;
+            ::close(fd);
+            if (mem == MAP_FAILED) {
+                throw std::system_error(err, std::generic_category(), "mmap " + name);
+            }
+            m_header = static_cast<Header*>(mem);
+            m_cells = static_cast<unsigned char*>(mem) + (sizeof(Header) + 63) / 64 * 64;
+
+            if (creator) {
+                new (m_header) Header{};
+                m_header->payloadSize = static_cast<uint32_t>(payloadSize);
+                m_header->capacity = m_capacity;
+                m_header->cellSize = m_cellSize;
+                for (size_t i = 0; i < m_capacity; ++i) {
+                    new (cellAt(i)) std::atomic<uint64_t>(i);
+                }
+                m_header->magic.store(Magic, std::memory_order_release);
+            }
+            else {
+                for (int i = 0; i < 1000 && m_header->magic.load(std::memory_order_acquire) != Magic; ++i) {
+                    ::usleep(1000);
+                }
+                if (m_header->magic.load(std::memory_order_acquire) != Magic || m_header->payloadSize != payloadSize
+                    || m_header->capacity != m_capacity || m_header->cellSize != m_cellSize) {
+                    ::munmap(mem, m_size);
+                    throw std::system_error(EINVAL, std::generic_category(), "shared signal layout mismatch " + name);
+                }
+            }
+        }
+
+        ShmRing(const ShmRing&) = delete;
+        ShmRing& operator=(const ShmRing&) = delete;
+
+        ~ShmRing() {
+            ::munmap(m_header, m_size);
+        }
+
+        // write(void* dst) 把一个事件写入格子。队列满时返回 false。
+        template<typename Write>
+        bool push(Write&& write) noexcept {
+            uint64_t pos = m_header->enqueuePos.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = cellAt(pos);
+                uint64_t seq = cell->seq.load(std::memory_order_acquire);
+                auto diff = static_cast<int64_t>(seq - pos);
+                if (diff == 0) {
+                    if (m_header->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else {
+                    pos = m_header->enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            write(static_cast<void*>(cell->data));
+            cell->seq.store(pos + 1, std::memory_order_release);
+
+            // 与 wait() 中先登记再检查队列配对，两边至少有一方看到对方。
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_header->waiters.load(std::memory_order_relaxed) != 0) {
+                m_header->wakeSeq.fetch_add(1, std::memory_order_release);
+                futex(&m_header->wakeSeq, FUTEX_WAKE, INT_MAX, nullptr);
+            }
+            return true;
+        }
+
+        // read(const void* src) 取出一个事件，返回后格子交还给发送方。队列空时返回 false。
+        template<typename Read>
+        bool pop(Read&& read) {
+            uint64_t pos = m_header->dequeuePos.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = cellAt(pos);
+                uint64_t seq = cell->seq.load(std::memory_order_acquire);
+                auto diff = static_cast<int64_t>(seq - (pos + 1));
+                if (diff == 0) {
+                    if (m_header->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = m_header->dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            read(static_cast<const void*>(cell->data));
+            cell->seq.store(pos + m_capacity, std::memory_order_release);
+            return true;
+        }
+
+        bool readable() const noexcept {
+            uint64_t pos = m_header->dequeuePos.load(std::memory_order_relaxed);
+            return cellAt(pos)->seq.load(std::memory_order_acquire) == pos + 1;
+        }
+
+        // 先自旋一小段时间，仍然没有事件时在 futex 上睡眠。timeoutMs 为负数时不超时。
+        bool wait(int timeoutMs) noexcept {
+            for (int i = 0; i < SpinCount; ++i) {
+                if (readable()) {
+                    return true;
+                }
+            }
+
+            uint32_t seq = m_header->wakeSeq.load(std::memory_order_acquire);
+            m_header->waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!readable()) {
+                struct timespec ts = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+                futex(&m_header->wakeSeq, FUTEX_WAIT, seq, timeoutMs < 0 ? nullptr : &ts);
+            }
+            m_header->waiters.fetch_sub(1, std::memory_order_relaxed);
+            return readable();
+        }
+
+        uint64_t dropped() const noexcept {
+            return m_header->dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        Cell* cellAt(uint64_t pos) const noexcept {
+            return reinterpret_cast<Cell*>(m_cells + (pos & (m_capacity - 1)) * m_cellSize);
+        }
+
+        // 共享内存中的 futex 不能使用 FUTEX_PRIVATE_FLAG。
+        static long futex(std::atomic<uint32_t>* addr, int op, uint32_t value, const struct timespec* timeout) noexcept {
+            return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op, value, timeout, nullptr, 0);
+        }
+
+        Header* m_header = nullptr;
+        unsigned char* m_cells = nullptr;
+        size_t m_capacity = 0;
+        size_t m_cellSize = 0;
+        size_t m_size = 0;
+    };
+
+    // 参数在格子中按声明顺序、各自的对齐存放。
+    template<typename... Args>
+    struct ShmPayload
+    {
+        static_assert((... && std::is_trivially_copyable_v<remove_rcv_t<Args>>), "shared signal arguments must be trivially copyable.");
+        static_assert((... && !std::is_pointer_v<remove_rcv_t<Args>>), "pointers are meaningless in another process.");
+
+        struct Layout {
+            size_t offsets[sizeof...(Args) + 1];
+            size_t size;
+        };
+
+        static constexpr Layout layout() {
+            Layout l = {};
+            size_t sizes[] = { sizeof(remove_rcv_t<Args>)..., 0 };
+            size_t aligns[] = { alignof(remove_rcv_t<Args>)..., 1 };
+            size_t offset = 0;
+            for (size_t i = 0; i < sizeof...(Args); ++i) {
+                offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+                l.offsets[i] = offset;
+                offset += sizes[i];
+            }
+            l.size = offset;
+            return l;
+        }
+
+        static constexpr Layout value = layout();
+        static constexpr size_t size = value.size;
+        static constexpr size_t align = (std::max)({ alignof(std::max_align_t), alignof(remove_rcv_t<Args>)... });
+
+        template<size_t... Index>
+        static void write(void* dst, std::index_sequence<Index...>, const remove_rcv_t<Args>&... args) noexcept {
+            (std::memcpy(static_cast<unsigned char*>(dst) + value.offsets[Index], std::addressof(args), sizeof(args)), ...);
+        }
+
+        template<size_t I>
+        using Type = remove_rcv_t<std::tuple_element_t<I, std::tuple<Args...>>>;
+
+        template<size_t I>
+        static Type<I>& get(unsigned char* buf) noexcept {
+            return *std::launder(reinterpret_cast<Type<I>*>(buf + value.offsets[I]));
+        }
+    };
+}
+
+/// 连接本地信号，把每次发送的参数写入共享内存队列。
+template<typename... Args>
+class SharedSignalSender : public Object {
+    using Payload = objectImpl::ShmPayload<Args...>;
+
+public:
+    explicit SharedSignalSender(const std::string& name, size_t capacity = 1024)
+        : m_ring(name, capacity, Payload::size) {
+    }
+
+    /// 直接连接 signal，在发送线程中写入队列。
+    template<typename Policy>
+    SharedSignalSender(objectImpl::BasicSignal<Policy, Args...>& signal, const std::string& name, size_t capacity = 1024)
+        : SharedSignalSender(name, capacity) {
+        signal.connect(this, &SharedSignalSender::send, ConnecttionType::Direct);
+    }
+
+    /// 写入一个事件。队列满时丢弃并返回 false。
+    bool send(const objectImpl::remove_rcv_t<Args>&... args) noexcept {
+        return m_ring.push([&](void* dst) {
+            Payload::write(dst, std::index_sequence_for<Args...>{}, args...);
+        });
+    }
+
+    /// 所有发送方因队列满丢弃的事件数。
+    uint64_t dropped() const noexcept {
+        return m_ring.dropped();
+    }
+
+private:
+    objectImpl::ShmRing m_ring;
+};
+
+/// 从共享内存队列取出事件，通过 received 信号发送。
+template<typename... Args>
+class SharedSignalReceiver : public Object {
+    using Payload = objectImpl::ShmPayload<Args...>;
+
+public:
+    explicit SharedSignalReceiver(const std::string& name, size_t capacity = 1024)
+        : m_ring(name, capacity, Payload::size) {
+    }
+
+    /// 取出已到达的所有事件，依次发送 received。格子在发送前交还，槽中可以继续接收。返回事件个数。
+    size_t processEvents() {
+        size_t count = 0;
+        alignas(Payload::align) unsigned char buf[Payload::size ? Payload::size : 1];
+        while (m_ring.pop([&](const void* src) { std::memcpy(buf, src, Payload::size); })) {
+            dispatch(buf, std::index_sequence_for<Args...>{});
+            ++count;
+        }
+        return count;
+    }
+
+    /// 等待直到有事件可取或超时（毫秒，负数不超时），返回是否有事件。
+    bool wait(int timeoutMs = -1) noexcept {
+        return m_ring.wait(timeoutMs);
+    }
+
+    uint64_t dropped() const noexcept {
+        return m_ring.dropped();
+    }
+
+    Signal(received, Args...)
+
+private:
+    template<size_t... Index>
+    void dispatch(unsigned char* buf, std::index_sequence<Index...>) {
+        emit received(Payload::template get<Index>(buf)...);
+    }
+
+    objectImpl::ShmRing m_ring;
+};
+
+/// 删除共享内存对象。已经打开的进程不受影响，之后打开同名队列时重新创建。
+inline bool removeSharedSignal(const std::string& name) {
+    return ::shm_unlink(name.c_str()) == 0;
+}
@@ -0,0 +1,82 @@
+// 协程等待信号的回归检查，需要 C++20。失败时返回非 0，配合 AddressSanitizer 运行可以发现释放后使用。
+#include "object.h"
+#include <cstdio>
+#include <exception>
+
+#ifdef OBJECT_HAS_COROUTINES
+namespace
+{
+    struct Task {
+        struct promise_type {
+            Task get_return_object() noexcept {
+                return {};
+            }
+            std::suspend_never initial_suspend() noexcept {
+                return {};
+            }
+            std::suspend_never final_suspend() noexcept {
+                return {};
+            }
+            void return_void() noexcept {
+            }
+            void unhandled_exception() noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    struct Worker : public Object {
+        Signal(finished, int)
+    };
+
+    int g_failures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    // 恢复后删除发送者，发送在协程返回后不能再访问信号。
+    Task deleteAfterFinished(Worker* w, int& result) {
+        auto value = co_await w->finished;
+        result = value ? std::get<0>(*value) : -1;
+        delete w;
+    }
+
+    void deleteSenderFromWaiter() {
+        auto w = new Worker;
+        int result = 0;
+        int slotCalls = 0;
+        w->finished.connect([&slotCalls](int) { ++slotCalls; });
+        deleteAfterFinished(w, result);
+        emit w->finished(7);
+        check(result == 7, "waiter receives the emitted value");
+        check(slotCalls == 0, "slots are not called after the sender is deleted");
+    }
+
+    void deleteSenderFromWaiterInBatch() {
+        auto w = new Worker;
+        int result = 0;
+        int slotCalls = 0;
+        w->finished.connect([&slotCalls](int) { ++slotCalls; });
+        deleteAfterFinished(w, result);
+        const int values[] = { 1, 2, 3 };
+        w->finished.emitBatch(3, values);
+        check(result == 1, "waiter receives the first event of the batch");
+        check(slotCalls == 0, "batch slots are not called after the sender is deleted");
+    }
+}
+
+int main() {
+    deleteSenderFromWaiter();
+    deleteSenderFromWaiterInBatch();
+    return g_failures ? 1 : 0;
+}
+#else
+int main() {
+    std::printf("coroutines are not available\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,115 @@
+// 多个线程同时发送，另一个线程不断连接、阻塞、断开同一个信号上的连接；以及 ConnectionHandle 的基本行为。
+// 失败时返回非 0。配合 ThreadSanitizer 运行可以检查连接数组快照和纪元回收的同步。
+#include "object.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Receiver : public Object {
+        void onValue(int v) {
+            m_sum.fetch_add(v, std::memory_order_relaxed);
+        }
+
+        std::atomic<long long> m_sum = 0;
+    };
+
+    struct Sender : public Object {
+        Signal(value, int)
+    };
+
+    int g_failures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    // 一直连接着的槽每次发送都恰好调用一次，不受同时进行的连接、断开影响。
+    void emitDuringChurn() {
+        constexpr int Emitters = 4;
+        constexpr int EmitsPerThread = 20000;
+
+        Sender sender;
+        Receiver stable;
+        sender.value.connect(&stable, &Receiver::onValue, ConnecttionType::Direct);
+
+        std::atomic<int> running = Emitters;
+        std::atomic<long long> churnCalls = 0;
+        std::thread churn([&] {
+            Receiver extra;
+            size_t rounds = 0;
+            while (running.load(std::memory_order_acquire) > 0) {
+                auto handle = sender.value.connect([&churnCalls](int) { churnCalls.fetch_add(1, std::memory_order_relaxed); });
+                sender.value.connect(&extra, &Receiver::onValue, ConnecttionType::Direct);
+                handle.setBlocked(true);
+                handle.setBlocked(false);
+                sender.value.disconnect(&extra);
+                handle.disconnect();
+                ++rounds;
+            }
+            check(rounds > 0, "the churn thread made progress");
+        });
+
+        std::vector<std::thread> emitters;
+        for (int t = 0; t < Emitters; ++t) {
+            emitters.emplace_back([&] {
+                for (int i = 0; i < EmitsPerThread; ++i) {
+                    emit sender.value(1);
+                }
+                running.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        for (auto& emitter : emitters) {
+            emitter.join();
+        }
+        churn.join();
+
+        check(stable.m_sum.load() == static_cast<long long>(Emitters) * EmitsPerThread, "the stable slot runs once per emit");
+        synchronizeSignals();
+    }
+
+    void connectionHandles() {
+        Sender sender;
+        int calls = 0;
+        auto handle = sender.value.connect([&calls](int v) { calls += v; });
+        check(handle.isConnected(), "connect returns a connected handle");
+
+        handle.setBlocked(true);
+        emit sender.value(1);
+        check(calls == 0 && handle.blocked(), "a blocked connection is skipped");
+        handle.setBlocked(false);
+        emit sender.value(1);
+        check(calls == 1, "an unblocked connection is called again");
+
+        auto copy = handle;
+        check(handle.disconnect(), "disconnect returns true for a connected handle");
+        check(!copy.disconnect() && !copy.isConnected(), "copies share the connection");
+        emit sender.value(1);
+        check(calls == 1, "a disconnected slot is not called");
+
+        {
+            ScopedConnection scoped = sender.value.connect([&calls](int v) { calls += v; });
+            emit sender.value(1);
+        }
+        emit sender.value(1);
+        check(calls == 2, "ScopedConnection disconnects when it goes out of scope");
+
+        ConnectionHandle outlived;
+        {
+            Sender temporary;
+            outlived = temporary.value.connect([&calls](int v) { calls += v; });
+        }
+        check(!outlived.isConnected(), "a handle outliving its sender reports disconnected");
+    }
+}
+
+int main() {
+    emitDuringChurn();
+    connectionHandles();
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// Queued、BlockingQueued、Auto 连接在接收者所属的线程中调用，槽中 sender() 是发送者。失败时返回非 0。
+#include "object.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Receiver : public Object {
+        void onText(const std::string& text) {
+            m_text = text;
+            m_loop = EventLoop::current();
+            m_sender = sender();
+            m_calls.fetch_add(1, std::memory_order_release);
+        }
+
+        std::string m_text;
+        EventLoop* m_loop = nullptr;
+        Object* m_sender = nullptr;
+        std::atomic<int> m_calls = 0;
+    };
+
+    struct Sender : public Object {
+        Signal(text, std::string)
+    };
+
+    int g_failures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    bool waitForCalls(const Receiver& receiver, int calls) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (receiver.m_calls.load(std::memory_order_acquire) < calls) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void deliverToOtherThread(ConnecttionType type) {
+        EventLoopThread worker;
+        Sender sender;
+        Receiver receiver;
+        receiver.moveToThread(worker.loop());
+        sender.text.connect(&receiver, &Receiver::onText, type);
+
+        {
+            std::string text = "queued";
+            emit sender.text(text);
+        }
+        if (type == ConnecttionType::BlockingQueued) {
+            check(receiver.m_calls.load(std::memory_order_acquire) == 1, "BlockingQueued returns after the slot has run");
+        }
+        check(waitForCalls(receiver, 1), "the slot runs on the receiver's thread");
+        check(receiver.m_loop == worker.loop(), "the slot runs in the receiver's event loop");
+        check(receiver.m_sender == &sender, "sender() is the emitting object");
+        check(receiver.m_text == "queued", "queued arguments are copied");
+        sender.text.disconnect();
+    }
+
+    // 接收者在发送线程中时，Queued 连接等到这个线程处理事件时才调用。
+    void deliverToSameThread() {
+        Sender sender;
+        Receiver receiver;
+        sender.text.connect(&receiver, &Receiver::onText, ConnecttionType::Queued);
+        emit sender.text("later");
+        check(receiver.m_calls.load() == 0, "Queued does not call the slot during emit");
+        EventLoop::current()->processEvents();
+        check(receiver.m_calls.load() == 1, "processEvents() runs the queued call");
+        check(receiver.m_loop == EventLoop::current() && receiver.m_sender == &sender, "queued call on the same thread keeps sender()");
+        check(::sender() == nullptr, "sender() is reset after the slot returns");
+    }
+}
+
+int main() {
+    deliverToOtherThread(ConnecttionType::Queued);
+    deliverToOtherThread(ConnecttionType::BlockingQueued);
+    deliverToOtherThread(ConnecttionType::Auto);
+    deliverToSameThread();
+    synchronizeSignals();
+    return g_failures ? 1 : 0;
+}
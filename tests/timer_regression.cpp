@@ -0,0 +1,120 @@
+// TimerWheel::advance() 的到期时刻、高层下放、单次与重复、stop() 以及随父对象析构。失败时返回非 0。
+#include "object.h"
+#include <cstdio>
+
+namespace
+{
+    int g_failures = 0;
+
+    void check(bool ok, const char* what) {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    // 在到期的 tick 上发送，前一个 tick 不发送。
+    void exactTick() {
+        TimerWheel wheel;
+        Timer timer(&wheel);
+        uint64_t firedAt = 0;
+        timer.timeout.connect([&] { firedAt = wheel.now(); });
+        timer.setSingleShot(true);
+        timer.start(10);
+        check(timer.remainingTicks() == 10, "remainingTicks() after start");
+        check(wheel.advance(9) == 0 && firedAt == 0, "no timeout before the interval");
+        check(wheel.advance(1) == 1 && firedAt == 10, "timeout at the exact tick");
+    }
+
+    // 超过第 0 层范围的定时器先放在高层，下放之后仍然在到期的 tick 上发送。
+    void cascade() {
+        TimerWheel wheel;
+        Timer near(&wheel), far(&wheel), farther(&wheel);
+        uint64_t nearAt = 0, farAt = 0, fartherAt = 0;
+        near.timeout.connect([&] { nearAt = wheel.now(); });
+        far.timeout.connect([&] { farAt = wheel.now(); });
+        farther.timeout.connect([&] { fartherAt = wheel.now(); });
+        near.setSingleShot(true);
+        far.setSingleShot(true);
+        farther.setSingleShot(true);
+        near.start(300);
+        far.start(70000);
+        farther.start(20000000);
+
+        check(wheel.advance(69999) == 1 && nearAt == 300, "a level-1 timer fires at its tick");
+        check(farAt == 0 && far.remainingTicks() == 1, "a level-2 timer is still pending");
+        check(wheel.advance(1) == 1 && farAt == 70000, "a level-2 timer fires after cascading");
+        check(wheel.advance(20000000) == 1 && fartherAt == 20000000, "a level-3 timer fires after cascading twice");
+        check(wheel.size() == 0, "single-shot timers leave the wheel");
+    }
+
+    // 重复的定时器每个间隔发送一次，一次 advance() 可以发送多次；单次的只发送一次。
+    void singleShotAndRepeating() {
+        TimerWheel wheel;
+        Timer repeating(&wheel), once(&wheel);
+        int repeats = 0, onces = 0;
+        repeating.timeout.connect([&] { ++repeats; });
+        once.timeout.connect([&] { ++onces; });
+        once.setSingleShot(true);
+        repeating.start(3);
+        once.start(3);
+
+        check(wheel.advance(10) == 4, "advance() returns the number of timeouts");
+        check(repeats == 3 && onces == 1, "repeating fires every interval, single-shot once");
+        check(repeating.isActive() && !once.isActive(), "only the repeating timer stays active");
+        check(repeating.remainingTicks() == 2, "the repeating timer keeps its phase");
+    }
+
+    void stop() {
+        TimerWheel wheel;
+        Timer timer(&wheel), stopper(&wheel);
+        int calls = 0;
+        timer.timeout.connect([&] { ++calls; });
+        timer.start(5);
+        timer.stop();
+        check(!timer.isActive() && wheel.size() == 0, "stop() removes the timer");
+        check(wheel.advance(10) == 0 && calls == 0, "a stopped timer does not fire");
+
+        // 槽中停止同一个 tick 到期、还没有发送的定时器。
+        stopper.timeout.connect([&] { timer.stop(); });
+        stopper.setSingleShot(true);
+        stopper.start(4);
+        timer.start(4);
+        wheel.advance(4);
+        check(calls == 0 && !timer.isActive(), "a timer stopped by an earlier timeout in the same tick does not fire");
+
+        // 重复的定时器在自己的槽中停止。
+        timer.timeout.disconnect();
+        timer.timeout.connect([&] {
+            if (++calls == 2) {
+                timer.stop();
+            }
+        });
+        timer.start(2);
+        wheel.advance(20);
+        check(calls == 2 && wheel.size() == 0, "a repeating timer stopped in its slot");
+    }
+
+    // 定时器随父对象析构时自动停止，时间轮中不再有它。
+    void parentDestroyed() {
+        TimerWheel wheel;
+        int calls = 0;
+        auto parent = new Object;
+        auto timer = new Timer(&wheel, parent);
+        timer->timeout.connect([&] { ++calls; });
+        timer->start(8);
+        check(wheel.size() == 1, "the child timer is running");
+        delete parent;
+        check(wheel.size() == 0, "destroying the parent stops the timer");
+        check(wheel.advance(16) == 0 && calls == 0, "a destroyed timer does not fire");
+    }
+}
+
+int main() {
+    exactTick();
+    cascade();
+    singleShotAndRepeating();
+    stop();
+    parentDestroyed();
+    return g_failures ? 1 : 0;
+}